@@ -0,0 +1,147 @@
+/* fanout.cpp                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Synthetic high fan-out benchmark for static Nabbit.
+//
+// One source node broadcasts to F leaf nodes, each of which spins for
+// a fixed amount of work.  The DAG is run once for each parallel
+// notify threshold, to find the fan-out at which splitting up the
+// notification starts to pay off.
+//
+// Usage: fanout [F] [work] [reps]
+
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <nabbit.h>
+
+
+class FanoutNode : public StaticNabbitNode {
+ public:
+  int work;
+  volatile long result;
+
+  FanoutNode() : StaticNabbitNode(0), work(0), result(0) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    long x = this->key;
+    for (int i = 0; i < this->work; i++) {
+      x = x * 1103515245 + 12345;
+    }
+    this->result = x | 1;
+  }
+};
+
+
+// Returns the average time of one run of the DAG, in microseconds.
+double time_fanout(StaticDAG<StaticNabbitNode>* dag,
+                   FanoutNode* nodes, int F, int reps) {
+  double total_us = 0;
+  for (int r = 0; r < reps; r++) {
+    for (int i = 0; i <= F; i++) {
+      nodes[i].result = 0;
+    }
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    nabbit::execute([&]() { nodes[0].source_compute(); });
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    total_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+
+    for (int i = 0; i <= F; i++) {
+      assert(nodes[i].result != 0);
+    }
+    dag->reset();
+  }
+  return total_us / reps;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int F = 100000;
+  int work = 100;
+  int reps = 5;
+  if (argc >= 2) {
+    F = atoi(argv[1]);
+  }
+  if (argc >= 3) {
+    work = atoi(argv[2]);
+  }
+  if (argc >= 4) {
+    reps = atoi(argv[3]);
+  }
+
+  // Node 0 is the source, and nodes 1 .. F are its successors.
+  std::vector<FanoutNode> nodes(F + 1);
+  std::vector<long long> src(F);
+  std::vector<long long> dst(F);
+  for (int i = 0; i <= F; i++) {
+    nodes[i].key = i;
+    nodes[i].work = work;
+  }
+  for (int i = 0; i < F; i++) {
+    src[i] = 0;
+    dst[i] = i + 1;
+  }
+
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(F + 1);
+  builder.add_edges(src.data(), dst.data(), F);
+  builder.build_from_array(&dag, nodes.data());
+
+  // INT_MAX always notifies serially.
+  const int thresholds[] = { INT_MAX, 16384, 4096, 1024, 256, 64, 16 };
+  const int num_thresholds = sizeof(thresholds) / sizeof(thresholds[0]);
+  int saved_threshold = nabbit::parallel_notify_threshold();
+
+  printf("Fan-out %d, work %d, P = %d\n", F, work, NABBIT_WKR_COUNT);
+  for (int t = 0; t < num_thresholds; t++) {
+    nabbit::set_parallel_notify_threshold(thresholds[t]);
+    double us = time_fanout(&dag, nodes.data(), F, reps);
+    if (thresholds[t] == INT_MAX) {
+      printf("%d, serial, %f  ; //Key: P, Threshold, Time(us)\n",
+             NABBIT_WKR_COUNT, us);
+    }
+    else {
+      printf("%d, %d, %f  ; //Key: P, Threshold, Time(us)\n",
+             NABBIT_WKR_COUNT, thresholds[t], us);
+    }
+  }
+  nabbit::set_parallel_notify_threshold(saved_threshold);
+  return 0;
+}
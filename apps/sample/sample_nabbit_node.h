@@ -82,8 +82,8 @@ void SampleDAGNode<NodeType>::InitNode() {
 template <class NodeType>
 void SampleDAGNode<NodeType>::Compute() {
 
-  for (int i = 0; i < this->predecessors->size_estimate(); i++) {
-    SampleDAGNode<NodeType>* child = (SampleDAGNode<NodeType>*)this->predecessors->get(i);
+  for (int i = 0; i < this->num_predecessors(); i++) {
+    SampleDAGNode<NodeType>* child = (SampleDAGNode<NodeType>*)this->predecessor(i);
     this->result += child->result;
   }
 
@@ -93,4 +93,50 @@ void SampleDAGNode<NodeType>::Compute() {
 }
 
 
+
+// The same node as SampleDAGNode<StaticNabbitNode>, except that the
+// values of the predecessors are summed as they finish.
+struct SampleSum {
+  int operator()(const int& a, const int& b) const { return a + b; }
+};
+
+class SampleReductionNode: public StaticReductionNode<int, SampleSum> {
+
+ private:
+  void InitNode();
+  void Compute();
+  int Contribution(StaticNabbitNode* pred);
+
+ public:
+  SampleReductionNode();
+  void* params;
+  int result;
+};
+
+
+SampleReductionNode::SampleReductionNode()
+  : StaticReductionNode<int, SampleSum>(0, 0),
+    params(NULL),
+    result(0) {
+}
+
+void SampleReductionNode::InitNode() {
+  this->result = 0;
+}
+
+int SampleReductionNode::Contribution(StaticNabbitNode* pred) {
+  return ((SampleReductionNode*)pred)->result;
+}
+
+void SampleReductionNode::Compute() {
+  // The source node has no value associated with it.
+  int own_value = (this->key < SAMPLE_DAG_SIZE-1) ? (int)this->key : 0;
+  this->result = own_value + this->merge_partials();
+
+  printf("At key %lld: computed value %d\n",
+	 this->key,
+	 this->result);
+}
+
+
 #endif // __SAMPLE_NABBIT_NODE_H
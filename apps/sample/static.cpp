@@ -46,6 +46,13 @@
 typedef enum {
     TEST_SERIAL = 0,
     TEST_STATIC_NABBIT = 1,
+    TEST_SERIAL_FROZEN = 2,
+    TEST_STATIC_NABBIT_FROZEN = 3,
+    TEST_SERIAL_BULK = 4,
+    TEST_STATIC_NABBIT_BULK = 5,
+    TEST_STATIC_NABBIT_CONTINUE = 6,
+    TEST_STATIC_NABBIT_PRIORITY = 7,
+    TEST_STATIC_NABBIT_REDUCTION = 8,
     TEST_ALL,
 } SampleTestType;
 
@@ -83,6 +90,27 @@ void create_static_DAG(SampleDAGNode<NodeType>* nodes, int n) {
 }
 
 
+// Builds the same DAG as create_static_DAG into dag, from a list of
+// edges.  Edge (src[k], dst[k]) corresponds to nodes[dst[k]].add_dep(&nodes[src[k]]).
+template <class NodeType, class BaseNodeType>
+void create_static_DAG_bulk(NodeType* nodes, int n,
+                            StaticDAG<BaseNodeType>* dag) {
+    assert(n <= SAMPLE_DAG_SIZE);
+    const long long src[] = {1, 2, 3, 4, 5, 3, 5, 6, 6, 7,
+                             SAMPLE_DAG_SIZE-1, SAMPLE_DAG_SIZE-1};
+    const long long dst[] = {0, 0, 1, 1, 1, 2, 2, 3, 4, 5, 6, 7};
+
+    for (int i = 0; i < n; i++) {
+        nodes[i].key = i;
+        nodes[i].params = NULL;
+    }
+
+    StaticDAGBuilder<BaseNodeType> builder(n);
+    builder.add_edges(src, dst, 12);
+    builder.build_from_array(dag, nodes);
+}
+
+
 void run_test(SampleTestType test_type) {  
     switch (test_type) {
     case TEST_SERIAL:
@@ -97,10 +125,124 @@ void run_test(SampleTestType test_type) {
     {
         SampleDAGNode<StaticNabbitNode> nodes[SAMPLE_DAG_SIZE];
         create_static_DAG(nodes, SAMPLE_DAG_SIZE);
-        nodes[SAMPLE_DAG_SIZE-1].source_compute();
+        // Parallel evaluation runs inside the current executor.
+        nabbit::execute([&]() {
+                nodes[SAMPLE_DAG_SIZE-1].source_compute();
+            });
         assert(nodes[0].result == 55);
     }
     break;    
+    case TEST_SERIAL_FROZEN:
+    {
+        SampleDAGNode<StaticSerialNode> nodes[SAMPLE_DAG_SIZE];
+        create_static_DAG(nodes, SAMPLE_DAG_SIZE);
+
+        // Compact the edges before running.
+        StaticDAG<StaticSerialNode> dag;
+        for (int i = 0; i < SAMPLE_DAG_SIZE; i++) {
+            dag.add_node(&nodes[i]);
+        }
+        dag.freeze();
+        assert(dag.num_edges() == 12);
+
+        nodes[SAMPLE_DAG_SIZE-1].source_compute();
+        assert(nodes[0].result == 55);
+    }
+    break;
+    case TEST_STATIC_NABBIT_FROZEN:
+    {
+        SampleDAGNode<StaticNabbitNode> nodes[SAMPLE_DAG_SIZE];
+        create_static_DAG(nodes, SAMPLE_DAG_SIZE);
+
+        StaticDAG<StaticNabbitNode> dag;
+        for (int i = 0; i < SAMPLE_DAG_SIZE; i++) {
+            dag.add_node(&nodes[i]);
+        }
+        dag.freeze();
+        assert(dag.num_edges() == 12);
+
+        nabbit::execute([&]() {
+                nodes[SAMPLE_DAG_SIZE-1].source_compute();
+            });
+        assert(nodes[0].result == 55);
+    }
+    break;
+    case TEST_SERIAL_BULK:
+    {
+        SampleDAGNode<StaticSerialNode> nodes[SAMPLE_DAG_SIZE];
+        StaticDAG<StaticSerialNode> dag;
+        create_static_DAG_bulk(nodes, SAMPLE_DAG_SIZE, &dag);
+        assert(dag.num_edges() == 12);
+
+        // The DAG finds its own sources: the real source, and node 8,
+        // which has no edges.
+        assert(dag.num_sources() == 2);
+        dag.execute_all();
+        assert(nodes[0].result == 55);
+    }
+    break;
+    case TEST_STATIC_NABBIT_BULK:
+    {
+        SampleDAGNode<StaticNabbitNode> nodes[SAMPLE_DAG_SIZE];
+        StaticDAG<StaticNabbitNode> dag;
+        create_static_DAG_bulk(nodes, SAMPLE_DAG_SIZE, &dag);
+        assert(dag.num_edges() == 12);
+
+        assert(dag.num_sources() == 2);
+        nabbit::execute([&]() { dag.execute_all(); });
+        assert(nodes[0].result == 55);
+    }
+    break;
+    case TEST_STATIC_NABBIT_CONTINUE:
+    {
+        SampleDAGNode<StaticNabbitNode> nodes[SAMPLE_DAG_SIZE];
+        StaticDAG<StaticNabbitNode> dag;
+        create_static_DAG_bulk(nodes, SAMPLE_DAG_SIZE, &dag);
+
+        // Run the last enabled successor of each node in place
+        // instead of spawning it.
+        dag.set_notify_policy(NOTIFY_CONTINUE_LAST);
+        nabbit::execute([&]() {
+                nodes[SAMPLE_DAG_SIZE-1].source_compute();
+            });
+        assert(nodes[0].result == 55);
+    }
+    break;
+    case TEST_STATIC_NABBIT_PRIORITY:
+    {
+        SampleDAGNode<StaticNabbitNode> nodes[SAMPLE_DAG_SIZE];
+        StaticDAG<StaticNabbitNode> dag;
+        create_static_DAG_bulk(nodes, SAMPLE_DAG_SIZE, &dag);
+
+        // Run successors on the longest remaining path first.  With
+        // unit costs, a node's priority is the number of nodes on its
+        // longest path to the sink.
+        dag.compute_priorities(NULL);
+        assert(nodes[0].get_priority() == 1);
+        assert(nodes[3].get_priority() == 3);
+        assert(nodes[SAMPLE_DAG_SIZE-1].get_priority() == 5);
+        nabbit::execute([&]() {
+                nodes[SAMPLE_DAG_SIZE-1].source_compute();
+            });
+        assert(nodes[0].result == 55);
+    }
+    break;
+    case TEST_STATIC_NABBIT_REDUCTION:
+    {
+        SampleReductionNode nodes[SAMPLE_DAG_SIZE];
+        StaticDAG<StaticNabbitNode> dag;
+        create_static_DAG_bulk(nodes, SAMPLE_DAG_SIZE, &dag);
+
+        // Run twice, to check that the partial sums are emptied.
+        for (int rep = 0; rep < 2; rep++) {
+            nabbit::execute([&]() {
+                    nodes[SAMPLE_DAG_SIZE-1].source_compute();
+                });
+            assert(nodes[0].result == 55);
+            dag.reset();
+        }
+    }
+    break;
     default:
         printf("No test type %d\n", test_type);
         assert(0);
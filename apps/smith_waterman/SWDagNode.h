@@ -115,7 +115,7 @@ void SWDAGNode<StaticNabbitNode>::Compute() {
   this->result = params->ComputeAtKey(this->key);
 
 #ifdef TRACK_THREAD_CPU_IDS
-  this->compute_id = cilk::current_worker_id();
+  this->compute_id = NABBIT_WKR_ID;
 #endif  
 }
 
@@ -95,7 +95,38 @@ class SWDAGParams {
 
   int ComputeAtKey(long long key);
 
+  void AllocateBlockDAG(void);
+
   SWNodeType* ConstructBlockDAG(void);
+
+  // Same as ConstructBlockDAG, but builds a frozen dag in parallel.
+  template <class BaseNodeType>
+  SWNodeType* ConstructBlockDAGBulk(StaticDAG<BaseNodeType>* dag);
+
+  // Registers all the block nodes with dag.
+  template <class BaseNodeType>
+  void RegisterBlockDAG(StaticDAG<BaseNodeType>* dag);
+
+  // Returns a new array with an estimated cost for each block, in the
+  // order in which blocks are registered with a StaticDAG.
+  long long* EstimateBlockCosts();
+
+  // Gives every block in block row bi an affinity for worker bi (mod
+  // P), so that the row boundary a block shares with its left
+  // neighbor stays in one worker's cache.
+  void SetBlockRowAffinity();
+
+  // The node for block (bi, bj).
+  SWNodeType* BlockNode(ArrayDim bi, ArrayDim bj);
+
+  // Adds delta to the entries of s that block (bi, bj) reads, i.e.,
+  // an edit to the input that only block (bi, bj) and the blocks
+  // after it depend on.
+  void AddToBlockS(ArrayDim bi, ArrayDim bj, int delta);
+
+  // Registers all the block nodes with dag, and freezes it.
+  template <class BaseNodeType>
+  void FreezeBlockDAG(StaticDAG<BaseNodeType>* dag);
   void CheckResult();
   void ReportStats();
 };
@@ -242,8 +273,9 @@ int SWDAGParams<SWNodeType>::ComputeAtKey(long long key) {
 
 
 
+// Allocates the result matrix and the (uninitialized) block nodes.
 template <class SWNodeType>
-SWNodeType* SWDAGParams<SWNodeType>::ConstructBlockDAG(void) {
+void SWDAGParams<SWNodeType>::AllocateBlockDAG(void) {
   SWDAGParams<SWNodeType>* params = this;
 
   ArrayDim final_col_blocks = 1 + (params->width + params->Bwidth-1) / params->Bwidth;
@@ -284,6 +316,16 @@ SWNodeType* SWDAGParams<SWNodeType>::ConstructBlockDAG(void) {
     printf("Done with allocation of dag nodes\n");
 #endif
   }
+}
+
+
+template <class SWNodeType>
+SWNodeType* SWDAGParams<SWNodeType>::ConstructBlockDAG(void) {
+  SWDAGParams<SWNodeType>* params = this;
+
+  AllocateBlockDAG();
+  ArrayDim final_col_blocks = params->blockdag_side;
+  ArrayDim final_row_blocks = params->blockdag_side;
 
   // Init all the nodes first.
   for (int bi = 0; bi < final_row_blocks; bi++) {
@@ -353,6 +395,128 @@ SWNodeType* SWDAGParams<SWNodeType>::ConstructBlockDAG(void) {
 }
 
 
+// Same as ConstructBlockDAG, but builds the edges into dag with a
+// StaticDAGBuilder.  Each block row generates its edges in parallel.
+template <class SWNodeType>
+template <class BaseNodeType>
+SWNodeType* SWDAGParams<SWNodeType>::ConstructBlockDAGBulk(StaticDAG<BaseNodeType>* dag) {
+  SWDAGParams<SWNodeType>* params = this;
+  AllocateBlockDAG();
+  const ArrayDim side = params->blockdag_side;
+  SWNodeType* tmp_data = params->block_data;
+
+  // Node (bi, bj) has index bi * side + bj in the builder.
+  StaticDAGBuilder<BaseNodeType> builder((long long)side * side);
+  nabbit::parallel_for(0, side, [&](long bi) {
+      long long* src = new long long[2*side];
+      long long* dst = new long long[2*side];
+      long long count = 0;
+      for (ArrayDim bj = 0; bj < side; bj++) {
+	long long midx = MortonIndexing::get_idx(bi, bj);
+	tmp_data[midx].key = midx;
+	tmp_data[midx].params = params;
+
+	long long idx = bi * side + bj;
+	if (bj > 0) {
+	  src[count] = idx - 1;
+	  dst[count] = idx;
+	  count++;
+	}
+	if (bi > 0) {
+	  src[count] = idx - side;
+	  dst[count] = idx;
+	  count++;
+	}
+      }
+      builder.add_edges(src, dst, count);
+      delete[] src;
+      delete[] dst;
+    });
+
+  builder.build(dag, [=](long long idx) -> BaseNodeType* {
+      return &(tmp_data[MortonIndexing::get_idx(idx / side, idx % side)]);
+    });
+
+  params->root = &(tmp_data[MortonIndexing::get_idx(side-1, side-1)]);
+  return params->root;
+}
+
+
+// Computing cell (i, j) scans its whole row and column, so it costs
+// O(i + j).  Up to a constant factor, block (bi, bj) costs
+// bi + bj + 1.
+template <class SWNodeType>
+long long* SWDAGParams<SWNodeType>::EstimateBlockCosts() {
+  const ArrayDim side = this->blockdag_side;
+  long long* costs = new long long[(long long)side * side];
+  for (ArrayDim bi = 0; bi < side; bi++) {
+    for (ArrayDim bj = 0; bj < side; bj++) {
+      costs[(long long)bi * side + bj] = bi + bj + 1;
+    }
+  }
+  return costs;
+}
+
+
+template <class SWNodeType>
+void SWDAGParams<SWNodeType>::SetBlockRowAffinity() {
+  const ArrayDim side = this->blockdag_side;
+  for (ArrayDim bi = 0; bi < side; bi++) {
+    for (ArrayDim bj = 0; bj < side; bj++) {
+      this->block_data[MortonIndexing::get_idx(bi, bj)].set_affinity((int)bi);
+    }
+  }
+}
+
+
+template <class SWNodeType>
+SWNodeType* SWDAGParams<SWNodeType>::BlockNode(ArrayDim bi, ArrayDim bj) {
+  return &(this->block_data[MortonIndexing::get_idx(bi, bj)]);
+}
+
+
+template <class SWNodeType>
+void SWDAGParams<SWNodeType>::AddToBlockS(ArrayDim bi, ArrayDim bj,
+					  int delta) {
+  // Blocks in row or column 0 are borders, which do not read s.
+  assert((bi > 0) && (bj > 0));
+  int start_row = 1 + (bi - 1) * this->Bheight;
+  int end_row = start_row + this->Bheight;
+  int start_col = 1 + (bj - 1) * this->Bwidth;
+  int end_col = start_col + this->Bwidth;
+  if (end_row > this->height+1) {
+    end_row = this->height+1;
+  }
+  if (end_col > this->width+1) {
+    end_col = this->width+1;
+  }
+  for (int i = start_row; i < end_row; i++) {
+    for (int j = start_col; j < end_col; j++) {
+      this->s->set(i, j, this->s->get(i, j) + delta);
+    }
+  }
+}
+
+
+template <class SWNodeType>
+template <class BaseNodeType>
+void SWDAGParams<SWNodeType>::RegisterBlockDAG(StaticDAG<BaseNodeType>* dag) {
+  for (ArrayDim bi = 0; bi < this->blockdag_side; bi++) {
+    for (ArrayDim bj = 0; bj < this->blockdag_side; bj++) {
+      long long midx = MortonIndexing::get_idx(bi, bj);
+      dag->add_node(&(this->block_data[midx]));
+    }
+  }
+}
+
+template <class SWNodeType>
+template <class BaseNodeType>
+void SWDAGParams<SWNodeType>::FreezeBlockDAG(StaticDAG<BaseNodeType>* dag) {
+  RegisterBlockDAG(dag);
+  dag->freeze();
+}
+
+
 // For now, this method doesn't actually do anything...
 template <class SWNodeType>
 void SWDAGParams<SWNodeType>::CheckResult() {
@@ -36,9 +36,10 @@
 // Dynamic Programming benchmark.
 
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
-#include <cilk/cilk.h>
 
 #include <example_util_gettime.h>
 #include <arrays/array2d_row.h>
@@ -70,6 +71,201 @@ const int K = 5;
 
 
 
+// The bulk variants after SW_STATIC_NABBIT_BULK set up, run and check
+// the block DAG in ways that only StaticNabbitNode supports, so
+// RunDAGEval() goes through the three steps below, overloaded on the
+// node type.  StaticSerialNode DAGs only come from the plain serial
+// variants, which need no setup or checks, and always run from the
+// source the first time.
+
+// Cost units for the variants that take block costs: a block costs
+// about B^3 cell updates per unit of EstimateBlockCosts().
+//
+// SW_STATIC_NABBIT_COARSE groups blocks into clusters of about
+// SW_COARSE_WORK cell updates.  SW_STATIC_NABBIT_ADAPTIVE picks the
+// serial engine for matrices of up to SW_SERIAL_WORK cell updates,
+// and runs blocks with less than SW_INLINE_WORK cell updates below
+// them inline.
+const long long SW_COARSE_WORK = 1 << 11;
+const long long SW_SERIAL_WORK = 1 << 18;
+const long long SW_INLINE_WORK = 1 << 12;
+
+
+// Sets up a freshly built block DAG for test_type.
+template <class ParamsType>
+void PrepareBlockDAG(StaticDAG<StaticSerialNode>* dag, ParamsType* params,
+		     SWComputeType test_type, bool verbose) {
+}
+
+template <class ParamsType>
+void PrepareBlockDAG(StaticDAG<StaticNabbitNode>* dag, ParamsType* params,
+		     SWComputeType test_type, bool verbose) {
+  long long unit = (long long)B * B * B;
+  switch (test_type) {
+
+  case SW_STATIC_NABBIT_CONTINUE:
+    // Runs the last enabled successor of each node inline.
+    dag->set_notify_policy(NOTIFY_CONTINUE_LAST);
+    break;
+
+  case SW_STATIC_NABBIT_PRIORITY:
+    {
+      // Prioritizes blocks on the critical path, weighted by cost.
+      long long* costs = params->EstimateBlockCosts();
+      dag->compute_priorities(costs);
+      delete[] costs;
+    }
+    break;
+
+  case SW_STATIC_NABBIT_AFFINITY:
+    // Keeps each block row on one worker.
+    params->SetBlockRowAffinity();
+    break;
+
+  case SW_STATIC_NABBIT_COARSE:
+    {
+      long long* costs = params->EstimateBlockCosts();
+      dag->coarsen(costs, std::max(SW_COARSE_WORK / unit, 1LL));
+      delete[] costs;
+      if (verbose) {
+	printf("Coarsened %lld blocks into %lld clusters\n",
+	       dag->num_nodes(), dag->num_clusters());
+      }
+    }
+    break;
+
+  case SW_STATIC_NABBIT_ADAPTIVE:
+    {
+      long long* costs = params->EstimateBlockCosts();
+      DAGTraversalType t = dag->choose_traversal(costs,
+						 SW_SERIAL_WORK / unit,
+						 SW_INLINE_WORK / unit);
+      delete[] costs;
+      if (verbose) {
+	printf("Chose %s traversal for %lld blocks\n",
+	       (t == SERIAL_STATIC_TRAVERSAL) ? "serial" : "parallel",
+	       dag->num_nodes());
+      }
+    }
+    break;
+
+  case SW_STATIC_NABBIT_LEVELS:
+    // Sorts the blocks into anti-diagonals.
+    nabbit::execute([&]() { dag->compute_levels(); });
+    if (verbose) {
+      printf("Sorted %lld blocks into %lld levels\n",
+	     dag->num_nodes(), dag->num_levels());
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+
+// Runs the block DAG, from the source on the first run, and from all
+// sources after a reset() on later runs.
+template <class ParamsType>
+void RunBlockDAG(StaticDAG<StaticSerialNode>* dag, ParamsType* params,
+		 SWComputeType test_type, bool first_run, bool verbose) {
+  if (first_run) {
+    SWDAGNode<StaticSerialNode>* source = params->block_data;
+    nabbit::execute([&]() { source->source_compute(); });
+  }
+  else {
+    nabbit::execute([&]() { dag->execute_all(); });
+  }
+}
+
+template <class ParamsType>
+void RunBlockDAG(StaticDAG<StaticNabbitNode>* dag, ParamsType* params,
+		 SWComputeType test_type, bool first_run, bool verbose) {
+  switch (test_type) {
+
+  case SW_STATIC_NABBIT_ADAPTIVE:
+    nabbit::execute([&]() { dag->execute_adaptive(); });
+    break;
+
+  case SW_STATIC_NABBIT_LEVELS:
+    // One anti-diagonal at a time, as sw_compute_pure_wavefront() does.
+    nabbit::execute([&]() { dag->execute_levels(); });
+    break;
+
+  case SW_STATIC_NABBIT_REPLAY:
+    // Records which worker computes each block in the first run, and
+    // replays that schedule in later runs.
+    if (first_run) {
+      nabbit::execute([&]() { dag->execute_and_record(); });
+    }
+    else {
+      nabbit::execute([&]() { dag->execute_replay(); });
+      if (verbose) {
+	printf("Replayed %lld blocks, %lld stolen\n",
+	       dag->num_nodes(), dag->num_replay_steals());
+      }
+    }
+    break;
+
+  default:
+    // The clusters of a coarsened DAG are only run from execute_all().
+    if (first_run && (test_type != SW_STATIC_NABBIT_COARSE)) {
+      SWDAGNode<StaticNabbitNode>* source = params->block_data;
+      nabbit::execute([&]() { source->source_compute(); });
+    }
+    else {
+      nabbit::execute([&]() { dag->execute_all(); });
+    }
+    break;
+  }
+}
+
+
+// Checks the block DAG after its first run.
+template <class ParamsType>
+void CheckBlockDAG(StaticDAG<StaticSerialNode>* dag, ParamsType* params,
+		   SWComputeType test_type, bool verbose) {
+}
+
+// SW_STATIC_NABBIT_INCREMENTAL edits the s entries of the middle
+// block, recomputes the blocks that depend on it, and checks the
+// result against a full run on the edited input.  Then it undoes the
+// edit and recomputes again, which should restore the original
+// result.
+template <class ParamsType>
+void CheckBlockDAG(StaticDAG<StaticNabbitNode>* dag, ParamsType* params,
+		   SWComputeType test_type, bool verbose) {
+  if (test_type != SW_STATIC_NABBIT_INCREMENTAL) {
+    return;
+  }
+  int first_result = params->root->GetResult();
+  ArrayDim mid = params->blockdag_side / 2;
+  StaticNabbitNode* dirty = params->BlockNode(mid, mid);
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  params->AddToBlockS(mid, mid, 7);
+  nabbit::execute([&]() { dag->recompute(dirty); });
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  int edited_result = params->root->GetResult();
+
+  dag->reset();
+  nabbit::execute([&]() { dag->execute_all(); });
+  int full_result = params->root->GetResult();
+  assert(edited_result == full_result);
+
+  params->AddToBlockS(mid, mid, -7);
+  nabbit::execute([&]() { dag->recompute(dirty); });
+  assert(params->root->GetResult() == first_result);
+
+  if (verbose) {
+    printf("Recomputed from block (%d, %d) of %lld: %f s, result %d -> %d (full run: %d)\n",
+	   (int)mid, (int)mid, (long long)dag->num_nodes(),
+	   std::chrono::duration<double>(t1 - t0).count(),
+	   first_result, edited_result, full_result);
+  }
+}
+
+
 template <class NodeType, class SType>
 int RunDAGEval(int n, int m,
 	       int* gamma,
@@ -77,36 +273,77 @@ int RunDAGEval(int n, int m,
 	       long* start_time,
 	       long* end_time,
 	       bool verbose,
-	       SWComputeType test_type) {
+	       SWComputeType test_type,
+	       int reps) {
   SWDAGParams<SWDAGNode<NodeType> > params;
   params.InitParameters(B, n, m);
   params.InitGammaAndS(gamma, s, false);
 
   *start_time = example_get_time();
-  SWDAGNode<NodeType>* root = params.ConstructBlockDAG();
-  
-  switch (test_type) {
+  StaticDAG<NodeType> dag;
+  SWDAGNode<NodeType>* root;
+  if ((test_type == SW_STATIC_NABBIT_BULK) ||
+      (test_type == SW_STATIC_SERIAL_BULK) ||
+      (test_type == SW_STATIC_NABBIT_CONTINUE) ||
+      (test_type == SW_STATIC_NABBIT_PRIORITY) ||
+      (test_type == SW_STATIC_NABBIT_AFFINITY) ||
+      (test_type == SW_STATIC_NABBIT_INCREMENTAL) ||
+      (test_type == SW_STATIC_NABBIT_COARSE) ||
+      (test_type == SW_STATIC_NABBIT_ADAPTIVE) ||
+      (test_type == SW_STATIC_NABBIT_LEVELS) ||
+      (test_type == SW_STATIC_NABBIT_REPLAY)) {
+    // Bulk variants build the frozen DAG from edge lists.
+    root = params.ConstructBlockDAGBulk(&dag);
+    PrepareBlockDAG(&dag, &params, test_type, verbose);
+  }
+  else {
+    root = params.ConstructBlockDAG();
 
-  case SW_STATIC_SERIAL:
-    {
-      SWDAGNode<StaticSerialNode>* source;
-      source = (SWDAGNode<StaticSerialNode>*) params.block_data;
-      source->source_compute();
+    // Frozen variants compact the edges into CSR arrays before running.
+    if ((test_type == SW_STATIC_NABBIT_FROZEN) ||
+	(test_type == SW_STATIC_SERIAL_FROZEN)) {
+      params.FreezeBlockDAG(&dag);
     }
-    break;
+  }
+  
+  RunBlockDAG(&dag, &params, test_type, true, verbose);
+  *end_time = example_get_time();
 
-  case SW_STATIC_NABBIT:
-    {
-      SWDAGNode<StaticNabbitNode>* source;
-      source = (SWDAGNode<StaticNabbitNode>*) params.block_data;
-      source->source_compute();      
+  CheckBlockDAG(&dag, &params, test_type, verbose);
+
+  // Run the same DAG again reps-1 times, resetting it in between, to
+  // measure the steady-state cost of reusing it.
+  if (reps > 1) {
+    if (dag.num_nodes() == 0) {
+      params.RegisterBlockDAG(&dag);
     }
-    break;
+    int first_result = root->GetResult();
+    double reset_us = 0;
+    double run_us = 0;
+    for (int r = 1; r < reps; r++) {
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      dag.reset();
+      std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+      RunBlockDAG(&dag, &params, test_type, false, verbose);
+      std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+      reset_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+      run_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+      assert(root->GetResult() == first_result);
+    }
+    reset_us /= (reps - 1);
+    run_us /= (reps - 1);
 
-  default:
-    assert(0);
+    if (verbose) {
+      printf("Reused DAG of %lld nodes %d times: reset = %f us/run, compute = %f s/run\n",
+	     dag.num_nodes(), reps - 1, reset_us, run_us / 1e6);
+    }
+    else {
+      printf("%d, %d, %lld, %f, %f ",
+	     test_type, reps - 1, dag.num_nodes(), reset_us, run_us / 1e6);
+      printf(" ; //Key: Test Type, Reuses, Nodes, Reset(us), Compute(s)\n");
+    }
   }
-  *end_time = example_get_time();
 
   if (verbose) {
     printf("The result: %d\n",
@@ -133,7 +370,9 @@ int main(int argc, char *argv[])
   bool run_gold = true;
 #endif
   bool verbose = false;
-  int P = NABBIT_WKR_COUNT;
+  const char* executor_name = NULL;
+  int reps = 1;
+  int P;
 
   if (argc >= 2) {
     n = atoi(argv[1]);
@@ -149,6 +388,29 @@ int main(int argc, char *argv[])
   if (argc >= 5) {
     run_gold = false;
   }
+  if (argc >= 6) {
+    executor_name = argv[5];
+  }
+  if (argc >= 7) {
+    reps = atoi(argv[6]);
+    assert(reps >= 1);
+  }
+
+#ifdef NABBIT_HAS_EXECUTORS
+  // Pick the executor to run on, e.g., "native", "openmp" or "tbb".
+  if ((executor_name != NULL) && !nabbit::set_executor(executor_name)) {
+    printf("Unknown executor %s.  Available executors:", executor_name);
+    for (const char* const* name = nabbit::executor_names(); *name != NULL; name++) {
+      printf(" %s", *name);
+    }
+    printf("\n");
+    return 1;
+  }
+  executor_name = nabbit::current_executor()->name();
+#else
+  executor_name = "default";
+#endif
+  P = NABBIT_WKR_COUNT;
 
   if (verbose) {
     printf("n = %d, m = %d:  ", n, m);
@@ -161,8 +423,8 @@ int main(int argc, char *argv[])
     max_mn = n;
   }
   if (verbose) {
-    printf("Test_type = %d, run_gold = %d\n",
-	   test_type, run_gold);
+    printf("Test_type = %d, run_gold = %d, executor = %s\n",
+	   test_type, run_gold, executor_name);
   }
 
 #ifndef COMPUTE_CONSTANT_EF 
@@ -223,12 +485,14 @@ int main(int argc, char *argv[])
   if (run_gold) {
     long start_time = example_get_time();
 
-    if (gold_type == SW_DC_K2) {
-      sw_compute_divide_and_conquer<M2Type, S2Type, B>(s2, gamma, M2);
-    }
-    else {
-      sw_compute_gold_generic<M2Type, S2Type >(s2, gamma, M2);
-    }
+    nabbit::execute([&]() {
+	if (gold_type == SW_DC_K2) {
+	  sw_compute_divide_and_conquer<M2Type, S2Type, B>(s2, gamma, M2);
+	}
+	else {
+	  sw_compute_gold_generic<M2Type, S2Type >(s2, gamma, M2);
+	}
+      });
     long end_time = example_get_time();
     double time_in_sec = (end_time - start_time) / 1000.f;
     double constant_val = 1e6 * (end_time - start_time) / (scale);
@@ -268,7 +532,9 @@ int main(int argc, char *argv[])
     {
       test_string = "Generic";
       start_time = example_get_time();
-      sw_compute_gold_generic<MType, SType >(s, gamma, M);
+      nabbit::execute([&]() {
+	  sw_compute_gold_generic<MType, SType >(s, gamma, M);
+	});
       end_time = example_get_time();
       answer = M->get(n, m);           
       
@@ -278,7 +544,9 @@ int main(int argc, char *argv[])
     {
       test_string = "Divide_and_Conquer_K2";
       start_time = example_get_time();
-      sw_compute_divide_and_conquer<MType, SType, B>(s, gamma, M);
+      nabbit::execute([&]() {
+	  sw_compute_divide_and_conquer<MType, SType, B>(s, gamma, M);
+	});
       end_time = example_get_time();
       answer = M->get(n, m);           
     }
@@ -288,7 +556,9 @@ int main(int argc, char *argv[])
     {
       test_string = "DC_Wavefront";
       start_time = example_get_time();
-      sw_compute_DC_wavefront<MType, SType, B, K>(s, gamma, M);
+      nabbit::execute([&]() {
+	  sw_compute_DC_wavefront<MType, SType, B, K>(s, gamma, M);
+	});
       end_time = example_get_time();
       answer = M->get(n, m);           
     }
@@ -298,7 +568,9 @@ int main(int argc, char *argv[])
     {
       test_string = "Pure_Wavefront";
       start_time = example_get_time();
-      sw_compute_pure_wavefront<MType, SType, B, K>(s, gamma, M);
+      nabbit::execute([&]() {
+	  sw_compute_pure_wavefront<MType, SType, B, K>(s, gamma, M);
+	});
       end_time = example_get_time();
       answer = M->get(n, m);
     }
@@ -311,7 +583,8 @@ int main(int argc, char *argv[])
 						   &start_time,
 						   &end_time,
 						   verbose,
-						   test_type);
+						   test_type,
+						   reps);
     }
     break;
 
@@ -322,7 +595,152 @@ int main(int argc, char *argv[])
 						   &start_time,
 						   &end_time,
 						   verbose,
-						   test_type);
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_FROZEN:
+    {
+      test_string = "Static_Nabbit_Frozen";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_SERIAL_FROZEN:
+    {
+      test_string = "Static_Serial_Frozen";
+      answer = RunDAGEval<StaticSerialNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_BULK:
+    {
+      test_string = "Static_Nabbit_Bulk";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_SERIAL_BULK:
+    {
+      test_string = "Static_Serial_Bulk";
+      answer = RunDAGEval<StaticSerialNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_CONTINUE:
+    {
+      test_string = "Static_Nabbit_Continue";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_PRIORITY:
+    {
+      test_string = "Static_Nabbit_Priority";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_AFFINITY:
+    {
+      test_string = "Static_Nabbit_Affinity";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_INCREMENTAL:
+    {
+      test_string = "Static_Nabbit_Incremental";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_ADAPTIVE:
+    {
+      test_string = "Static_Nabbit_Adaptive";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_COARSE:
+    {
+      test_string = "Static_Nabbit_Coarse";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_LEVELS:
+    {
+      test_string = "Static_Nabbit_Levels";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
+    }
+    break;
+
+  case SW_STATIC_NABBIT_REPLAY:
+    {
+      test_string = "Static_Nabbit_Replay";
+      answer = RunDAGEval<StaticNabbitNode, SType>(n, m, gamma, s,
+						   &start_time,
+						   &end_time,
+						   verbose,
+						   test_type,
+						   reps);
     }
     break;
 
@@ -40,6 +40,7 @@
 
 
 
+#include <nabbit_sysdep.h>
 #include <arrays/array2d_row.h>
 #include <arrays/array2d_morton.h>
 #include "matrix_utils.h"
@@ -269,14 +270,15 @@ int computeEij_parallel_divide_and_conquer(int* gamma,
     int val1, val2;
     int mid_i = (start_i + end_i) / 2;
     
-    val1 = cilk_spawn computeEijParallel(gamma,
-					 M, i, j,
-					 start_i, mid_i);
-
-    val2 = cilk_spawn computeEijParallel(gamma,
-					 M, i, j,
-					 mid_i, end_i);
-    cilk_sync;    
+    NABBIT_SPAWN_SCOPE;
+    NABBIT_SPAWN_ASSIGN(val1, computeEijParallel(gamma,
+					       M, i, j,
+					       start_i, mid_i));
+
+    NABBIT_SPAWN_ASSIGN(val2, computeEijParallel(gamma,
+					       M, i, j,
+					       mid_i, end_i));
+    NABBIT_SYNC;    
     return MAX(val1, val2);
   }
 }
@@ -310,14 +312,15 @@ int computeFij_parallel_divide_and_conquer(int* gamma,
     int val1, val2;
     int mid_j = (start_j + end_j) / 2;
     
-    val1 = cilk_spawn computeFijParallel(gamma,
-					 M, i, j,
-					 start_j, mid_j);
-
-    val2 = cilk_spawn computeFijParallel(gamma,
-					 M, i, j,
-					 mid_j, end_j);
-    cilk_sync;
+    NABBIT_SPAWN_SCOPE;
+    NABBIT_SPAWN_ASSIGN(val1, computeFijParallel(gamma,
+					       M, i, j,
+					       start_j, mid_j));
+
+    NABBIT_SPAWN_ASSIGN(val2, computeFijParallel(gamma,
+					       M, i, j,
+					       mid_j, end_j));
+    NABBIT_SYNC;
 
     return MAX(val1, val2);
   }
@@ -41,6 +41,7 @@
 #define __SW_MATRIX_KERNELS_H
 
 
+#include <nabbit_sysdep.h>
 #include "matrix_utils.h"
 #include "sw_computeEF.h"
 
@@ -48,7 +49,7 @@
 #include "sw_visual.h"
 #endif
 
-#define USE_CILKFOR_WAVEFRONT
+#define USE_PARALLEL_FOR_WAVEFRONT
 
 
 /**************************************************************/
@@ -144,7 +145,7 @@ void sw_compute_base(SMatrixType* s,
     node_rec.data.end_i = end_row;
     node_rec.data.start_j = start_col;
     node_rec.data.end_j = end_col;
-    node_rec.compute_id = cilk::current_worker_id();
+    node_rec.compute_id = NABBIT_WKR_ID;
   }
 #endif
 
@@ -229,14 +230,15 @@ void sw_compute_d_and_c_helper(SMatrixType* s,
     sw_compute_d_and_c_helper<MMatrixType, SMatrixType, base_size>(s, gamma, M,
 								   start_row, mid_row,
 								   start_col, mid_col);
-    
-    cilk_spawn sw_compute_d_and_c_helper<MMatrixType, SMatrixType, base_size>(s, gamma, M,
-									      start_row, mid_row,
-									      mid_col, end_col);
+
+    NABBIT_SPAWN_SCOPE;
+    NABBIT_SPAWN(sw_compute_d_and_c_helper<MMatrixType, SMatrixType, base_size>(s, gamma, M,
+										start_row, mid_row,
+										mid_col, end_col));
     sw_compute_d_and_c_helper<MMatrixType, SMatrixType, base_size>(s, gamma, M,
 								   mid_row, end_row,
 								   start_col, mid_col);
-    cilk_sync;
+    NABBIT_SYNC;
     
     sw_compute_d_and_c_helper<MMatrixType, SMatrixType, base_size>(s, gamma, M,
 								   mid_row, end_row,
@@ -297,93 +299,58 @@ void sw_compute_d_and_c_Ksplit(SMatrixType* s,
     int row_delta = (end_row - start_row)/K;
     int col_delta = (end_col - start_col)/K;
 
-    // Everything up in the upper left corner, including the longest
-    // diagonal.
-    for (int diag = 0; diag < K; diag++) {
-
-#ifdef USE_CILKFOR_WAVEFRONT
-      cilk_for (int i = 0; i <= diag; i++) 
-#else
-      for (int i = 0; i <= diag; i++) 
-#endif
-      {
-	int j = diag - i;
-
-	int row_s = start_row + i*row_delta;
-	int row_e = start_row + (i+1)*row_delta;
+    // Computes the block in row i and column j of the K by K split.
+    auto compute_block = [=](int i, int j) {
+      int row_s = start_row + i*row_delta;
+      int row_e = start_row + (i+1)*row_delta;
+      if (i == K-1) {
+	row_e = end_row;
+      }
 
-	if (i == K-1) {
-	  row_e = end_row;
-	}
+      int col_s = start_col + j*col_delta;
+      int col_e = start_col + (j+1)*col_delta;
+      if (j == K-1) {
+	col_e = end_col;
+      }
 
-	int col_s = start_col + j*col_delta;
-	int col_e = start_col + (j+1)*col_delta;
-	if (j == K-1) {
-	  col_e = end_col;
-	}
+      //	printf("(%d, %d): row_s = %d, row_e = %d, col_s = %d, col_e = %d\n",
+      //	       i, j,
+      //	       row_s, row_e,
+      //	       col_s, col_e);
+      sw_compute_d_and_c_Ksplit<MMatrixType, SMatrixType, base_size, K>(s, gamma, M,
+									row_s, row_e,
+									col_s, col_e);
+    };
 
-	//	printf("(%d, %d): row_s = %d, row_e = %d, col_s = %d, col_e = %d\n",
-	//	       i, j,
-	//	       row_s, row_e,
-	//	       col_s, col_e);
-#ifdef USE_CILKFOR_WAVEFRONT
-	sw_compute_d_and_c_Ksplit<MMatrixType, SMatrixType, base_size, K>(s, gamma, M,
-									  row_s, row_e,
-									  col_s, col_e);
+    // Everything up in the upper left corner, including the longest
+    // diagonal.
+    for (int diag = 0; diag < K; diag++) {
+#ifdef USE_PARALLEL_FOR_WAVEFRONT
+      nabbit::parallel_for(0, diag+1, [&](long i) {
+	  compute_block(i, diag - i);
+	});
 #else
-	cilk_spawn sw_compute_d_and_c_Ksplit<MMatrixType, SMatrixType, base_size, K>(s, gamma, M,
-										     row_s, row_e,
-										     col_s, col_e);
-#endif
+      NABBIT_SPAWN_SCOPE;
+      for (int i = 0; i <= diag; i++) {
+	NABBIT_SPAWN(compute_block(i, diag - i));
       }
-      
-#ifdef USE_CILKFOR_WAVEFRONT
-#else
-      cilk_sync;
+      NABBIT_SYNC;
 #endif
     }
 
     // Everything in the lower right corner.
     for (int diag = K; diag <= 2*K-2; diag++) {
-#ifdef USE_CILKFOR_WAVEFRONT
-      cilk_for (int j = diag - (K-1);  j < K; j++)
+#ifdef USE_PARALLEL_FOR_WAVEFRONT
+      nabbit::parallel_for(diag - (K-1), K, [&](long j) {
+	  compute_block(diag - j, j);
+	});
 #else
-      for (int j = diag - (K-1);  j < K; j++)
-#endif
-    {
-	int i = diag - j;
-
-	int row_s = start_row + i*row_delta;
-	int row_e = start_row + (i+1)*row_delta;
-	if (i == K-1) {
-	  row_e = end_row;
-	}
-
-	int col_s = start_col + j*col_delta;
-	int col_e = start_col + (j+1)*col_delta;
-	if (j == K-1) {
-	  col_e = end_col;
-	}
-
-	//	printf("(%d, %d): row_s = %d, row_e = %d, col_s = %d, col_e = %d\n",
-	//	       i, j,
-	//	       row_s, row_e,
-	//	       col_s, col_e);
-
-#ifdef USE_CILKFOR_WAVEFRONT
-	sw_compute_d_and_c_Ksplit<MMatrixType, SMatrixType, base_size, K>(s, gamma, M,
-									  row_s, row_e,
-									  col_s, col_e);
-#else
-	cilk_spawn  sw_compute_d_and_c_Ksplit<MMatrixType, SMatrixType, base_size, K>(s, gamma, M,
-										      row_s, row_e,
-										      col_s, col_e);	
-#endif
+      NABBIT_SPAWN_SCOPE;
+      for (int j = diag - (K-1);  j < K; j++) {
+	NABBIT_SPAWN(compute_block(diag - j, j));
       }
-#ifdef USE_CILKFOR_WAVEFRONT
-#else
-      cilk_sync;
-#endif    
+      NABBIT_SYNC;
+#endif
     }
   }
   else if (base_row && !base_col) {
@@ -455,7 +422,9 @@ void sw_compute_pure_wavefront(SMatrixType* s,
 /* 	   q - start_brow, */
 /* 	   q - end_brow); */
 
-    // Process the block in the top row.
+    // Process the block in the top row.  The block is spawned, and
+    // synced together with the rest of the diagonal below.
+    NABBIT_SPAWN_SCOPE;
     {
       int bi = 1 + start_brow * block_size;
       int end_row = bi + block_size;
@@ -474,9 +443,9 @@ void sw_compute_pure_wavefront(SMatrixType* s,
       //      printf("Spawning base. row range (%d, %d), col range (%d, %d)\n",
       //	     bi, end_row, bj, end_col);
       
-      cilk_spawn sw_compute_base(s, gamma, M,
-				 bi, end_row,
-				 bj, end_col);
+      NABBIT_SPAWN(sw_compute_base(s, gamma, M,
+				   bi, end_row,
+				   bj, end_col));
 
       //      sw_compute_base(s, gamma, M,
       //		      bi, end_row,
@@ -485,8 +454,8 @@ void sw_compute_pure_wavefront(SMatrixType* s,
     }
 
 
-#ifdef USE_CILKFOR_WAVEFRONT
-    cilk_for (int i = start_brow+1; i <= end_brow; i++) {
+#ifdef USE_PARALLEL_FOR_WAVEFRONT
+    nabbit::parallel_for(start_brow+1, end_brow+1, [&](long i) {
       int bi = 1 + i * block_size;
       int bj = 1 + (q - i) * block_size;
       int end_row = bi + block_size;
@@ -499,10 +468,9 @@ void sw_compute_pure_wavefront(SMatrixType* s,
       sw_compute_base(s, gamma, M,
 		      bi, end_row,
 		      bj, bj + block_size);
-    }
+      });
     
 #else
-    assert(0);
     for (int i = start_brow+1; i <= end_brow; i++) {      
       int bi = 1 + i * block_size;
       int bj = 1 + (q - i) * block_size;
@@ -511,13 +479,12 @@ void sw_compute_pure_wavefront(SMatrixType* s,
 	end_row = height;
       }      
 
-      cilk_spawn sw_compute_base(s, gamma, M,
-				 bi, end_row,
-				 bj, bj + block_size);
+      NABBIT_SPAWN(sw_compute_base(s, gamma, M,
+				   bi, end_row,
+				   bj, bj + block_size));
     }    
-    cilk_sync;                
 #endif
-
+    NABBIT_SYNC;
   }
 }
 		     
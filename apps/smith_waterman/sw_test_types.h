@@ -46,6 +46,18 @@ typedef enum {
     SW_PURE_WAVEFRONT=3,
     SW_STATIC_NABBIT=4,
     SW_STATIC_SERIAL=5,
+    SW_STATIC_NABBIT_FROZEN=6,
+    SW_STATIC_SERIAL_FROZEN=7,
+    SW_STATIC_NABBIT_BULK=8,
+    SW_STATIC_SERIAL_BULK=9,
+    SW_STATIC_NABBIT_CONTINUE=10,
+    SW_STATIC_NABBIT_PRIORITY=11,
+    SW_STATIC_NABBIT_AFFINITY=12,
+    SW_STATIC_NABBIT_INCREMENTAL=13,
+    SW_STATIC_NABBIT_COARSE=14,
+    SW_STATIC_NABBIT_ADAPTIVE=15,
+    SW_STATIC_NABBIT_LEVELS=16,
+    SW_STATIC_NABBIT_REPLAY=17,
     SW_MAX_TYPE,
 } SWComputeType;
 
@@ -56,6 +68,18 @@ static const char* SWTestTypeNames[] = {
     "Wavefront",
     "StaticNabbit",
     "StaticSerial",
+    "StaticNabbitFrozen",
+    "StaticSerialFrozen",
+    "StaticNabbitBulk",
+    "StaticSerialBulk",
+    "StaticNabbitContinue",
+    "StaticNabbitPriority",
+    "StaticNabbitAffinity",
+    "StaticNabbitIncremental",
+    "StaticNabbitCoarse",
+    "StaticNabbitAdaptive",
+    "StaticNabbitLevels",
+    "StaticNabbitReplay",
 };
 
 
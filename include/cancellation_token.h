@@ -0,0 +1,79 @@
+/* cancellation_token.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef __CANCELLATION_TOKEN_H_
+#define __CANCELLATION_TOKEN_H_
+
+/**
+ * A flag for stopping a DAG evaluation early.
+ *
+ * Attach a token to a static DAG with StaticDAG::set_cancellation_token()
+ * (or StaticNabbitNode::set_cancellation_token()), or to a dynamic DAG
+ * with TaskGraphHashTable::set_cancellation_token().  Once cancel()
+ * is called, from a Compute() or from any other thread, every node
+ * that the Nabbit engines would start next returns right away,
+ * without computing or notifying anything, so the evaluation drains
+ * quickly.  Compute() calls already running finish normally.
+ *
+ * If a Compute() throws, the engine cancels the node's token (if it
+ * has one) before the exception propagates to the caller of
+ * source_compute() or init_root_and_compute().
+ *
+ * After a cancelled run, the nodes are left partly computed: call
+ * reset() on the token, and StaticDAG::reset() (or rebuild the
+ * dynamic DAG), before running again.
+ *
+ * The engines only read the flag, once per node, so checking it costs
+ * a load.  To enforce a deadline, call cancel() from a timer.
+ */
+
+class CancellationToken {
+
+ public:
+  CancellationToken() : cancelled(0) { }
+
+  void cancel() { this->cancelled = 1; }
+  bool is_cancelled() const { return this->cancelled != 0; }
+  void reset() { this->cancelled = 0; }
+
+  // True if token is set and has been cancelled.
+  static bool is_cancelled(const CancellationToken* token) {
+    return (token != NULL) && token->is_cancelled();
+  }
+
+ private:
+  volatile int cancelled;
+};
+
+#endif // __CANCELLATION_TOKEN_H_
@@ -0,0 +1,221 @@
+/* combining_join_counter.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __COMBINING_JOIN_COUNTER_H_
+#define __COMBINING_JOIN_COUNTER_H_
+
+/**
+ * A join counter for nodes with many predecessors, organized as a
+ * combining tree.
+ *
+ * With a single counter, every predecessor of a node decrements the
+ * same cache line.  Here, each predecessor is assigned to a leaf by
+ * hashing its address, and decrements only that leaf.  The last
+ * arrival at a leaf decrements the leaf's parent, and so on up the
+ * tree; the last arrival at the root enables the node.  Each inner
+ * tree node has at most COMBINING_JOIN_ARITY children.  There is one
+ * leaf per COMBINING_JOIN_ARITY predecessors, but hashing only balances
+ * the leaves in expectation: a leaf may count more predecessors than
+ * that, so the bound on contention for a leaf is not strict.
+ *
+ * Every predecessor must arrive exactly once per run.  reset()
+ * restores the initial counts, and must not run concurrently with
+ * arrive().
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "nabbit_sysdep.h"
+
+namespace nabbit {
+
+  // Maximum fan-in of each counter in the tree.
+  const int COMBINING_JOIN_ARITY = 32;
+
+  // Nodes frozen with more than this many predecessors use a
+  // CombiningJoinCounter.  Can be changed at run time; it only
+  // affects DAGs frozen afterwards.
+#ifndef NABBIT_COMBINING_JOIN_THRESHOLD
+#   define NABBIT_COMBINING_JOIN_THRESHOLD 1024
+#endif
+
+  inline int& combining_join_threshold_slot() {
+    static int threshold = NABBIT_COMBINING_JOIN_THRESHOLD;
+    return threshold;
+  }
+
+  inline int combining_join_threshold() {
+    return combining_join_threshold_slot();
+  }
+
+  inline void set_combining_join_threshold(int threshold) {
+    assert(threshold > 0);
+    combining_join_threshold_slot() = threshold;
+  }
+};
+
+
+class CombiningJoinCounter {
+
+ public:
+  // Builds a tree for the n predecessors in preds.
+  template <class T>
+  CombiningJoinCounter(T* const* preds, int n);
+  ~CombiningJoinCounter();
+
+  // Records the arrival of pred.  Returns true for the last arrival.
+  inline bool arrive(const void* pred);
+
+  void reset();
+
+  int num_leaves() const { return num_leaf_counters; }
+
+ private:
+  // Each counter gets its own cache line, so the fields arrive()
+  // reads do not share a line with another counter's count.  new[]
+  // does not honor the alignment before C++17, so the counters are
+  // allocated with nabbit::aligned_malloc().
+  struct alignas(64) Counter {
+    std::atomic<long> count;
+    long initial;
+    int parent;
+  };
+  static_assert(sizeof(Counter) == 64, "a Counter must fill one cache line");
+
+  Counter* counters;
+  int num_counters;
+  int num_leaf_counters;
+
+  inline int leaf_for(const void* pred) const;
+
+  // Not copyable.
+  CombiningJoinCounter(const CombiningJoinCounter&);
+  CombiningJoinCounter& operator=(const CombiningJoinCounter&);
+};
+
+
+int CombiningJoinCounter::leaf_for(const void* pred) const {
+  // Fibonacci hashing on the address, ignoring the low bits that are
+  // the same for all nodes.
+  uint64_t h = ((uint64_t)(uintptr_t)pred >> 4) * 11400714819323198485ull;
+  return (int)((h >> 32) % (uint64_t)num_leaf_counters);
+}
+
+
+template <class T>
+CombiningJoinCounter::CombiningJoinCounter(T* const* preds, int n) {
+  assert(n > 0);
+  const int A = nabbit::COMBINING_JOIN_ARITY;
+
+  // Counters are stored level by level, leaves first.  level_start[k]
+  // is the index of the first counter on level k.
+  std::vector<int> level_start;
+  std::vector<int> level_size;
+  int width = (n + A - 1) / A;
+  num_leaf_counters = width;
+  num_counters = 0;
+  while (true) {
+    level_start.push_back(num_counters);
+    level_size.push_back(width);
+    num_counters += width;
+    if (width == 1) {
+      break;
+    }
+    width = (width + A - 1) / A;
+  }
+
+  void* storage = nabbit::aligned_malloc(num_counters * sizeof(Counter),
+                                         alignof(Counter));
+  if (storage == NULL) {
+    throw std::bad_alloc();
+  }
+  counters = static_cast<Counter*>(storage);
+  for (int i = 0; i < num_counters; i++) {
+    new (&counters[i]) Counter();
+    counters[i].initial = 0;
+    counters[i].parent = -1;
+  }
+
+  // Leaves count the predecessors that hash to them.
+  for (int i = 0; i < n; i++) {
+    counters[leaf_for(preds[i])].initial++;
+  }
+
+  // Counter j on level k is the child of counter j / A on level k+1.
+  // Only children with something to count report to their parent.
+  for (size_t k = 0; k + 1 < level_start.size(); k++) {
+    for (int j = 0; j < level_size[k]; j++) {
+      Counter* c = &counters[level_start[k] + j];
+      c->parent = level_start[k+1] + j / A;
+      if (c->initial > 0) {
+        counters[c->parent].initial++;
+      }
+    }
+  }
+  this->reset();
+}
+
+CombiningJoinCounter::~CombiningJoinCounter() {
+  for (int i = 0; i < num_counters; i++) {
+    counters[i].~Counter();
+  }
+  nabbit::aligned_free(counters);
+}
+
+bool CombiningJoinCounter::arrive(const void* pred) {
+  int idx = leaf_for(pred);
+  while (true) {
+    long remaining = counters[idx].count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    assert(remaining >= 0);
+    if (remaining > 0) {
+      return false;
+    }
+    if (counters[idx].parent < 0) {
+      return true;
+    }
+    idx = counters[idx].parent;
+  }
+}
+
+void CombiningJoinCounter::reset() {
+  for (int i = 0; i < num_counters; i++) {
+    counters[i].count.store(counters[i].initial, std::memory_order_relaxed);
+  }
+}
+
+#endif // __COMBINING_JOIN_COUNTER_H_
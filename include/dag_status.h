@@ -43,4 +43,11 @@ typedef enum { NODE_UNVISITED=0,
                NODE_COMPLETED=4,
                NODE_DEAD=5 } DAGNodeStatus;
 
+// The engines that can traverse a DAG.
+typedef enum { SERIAL_STATIC_TRAVERSAL=0,
+	       STATIC_NABBIT_TRAVERSAL=1,
+	       SERIAL_DYNAMIC_TRAVERSAL=2,
+	       DYNAMIC_NABBIT_TRAVERSAL=3
+} DAGTraversalType;
+
 #endif // __DAG_STATUS_H_
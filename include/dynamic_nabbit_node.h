@@ -34,9 +34,12 @@
 #define __DYNAMIC_NABBIT_NODE_H_
 
 
+#include <vector>
+
 #include "dag_status.h"
 #include "dynamic_array.h"
 #include "nabbit_sysdep.h"
+#include "sealed_succ_list.h"
 #include "task_graph_hash_table.h"
 
 
@@ -51,6 +54,14 @@ class DynamicNabbitNode;
 typedef DynamicArray<long long> DTGSKeyArray;
 typedef DynamicArray<DynamicNabbitNode*> DynamicNabbitNodeArray;
 
+// An entry in a node's list of successors to notify.  Each node owns
+// one link per predecessor, which it uses to register itself with
+// that predecessor, so registering does not allocate.
+struct DynamicNabbitSuccLink {
+  DynamicNabbitNode* node;
+  DynamicNabbitSuccLink* next;
+};
+
 
 class DynamicNabbitNode {
 
@@ -85,35 +96,62 @@ class DynamicNabbitNode {
   DAGNodeStatus volatile status;
   volatile long join_counter;
 
-  DynamicNabbitNodeArray* succ_to_notify;
+  // Successors waiting for this node.  Once this node is computed,
+  // it seals the list, and notifies every successor it took.
+  // Successors that try to register after that find the list sealed,
+  // and count this node as finished themselves.
+  SealedSuccList<DynamicNabbitSuccLink> succ_list;
+  DynamicNabbitSuccLink* pred_links;
   DTGSKeyArray* generated_tasks;
 
-  volatile int notify_counter; 
-  volatile int blocking_lock;
-
   inline void mark_as_visited();
 
   inline void mark_as_expanded();
 
   inline void mark_as_computed();
-  inline bool try_mark_as_completed();
-  inline bool try_acquire_blocking_lock();
-  inline void acquire_blocking_lock();
-  inline void release_blocking_lock();
-
+  inline void mark_as_completed();
 
-  void try_init_pred_and_compute(long long pred_key); 
+  void try_init_pred_and_compute(long long pred_key,
+                                 DynamicNabbitSuccLink* link);
+  void notify_links(DynamicNabbitSuccLink* link, int count);
   void init_node_and_compute();
   void compute_and_notify();
 
+#if defined(NABBIT_SERIALIZE)
+  // In a serialized build, each spawn above would be a nested call,
+  // one level of recursion per node.  Instead, the traversal keeps
+  // its recursion in an explicit stack of frames, as
+  // DynamicSerialNode does.  Each frame records which step of the
+  // recursive traversal a node is on.
+  enum FramePhase {
+    EXPAND_START,       // Call Init() on the node.
+    EXPAND_PREDS,       // Visit the predecessor at idx.
+    EXPAND_AFTER_PRED,  // Done expanding pred; wait on it if needed.
+    COMPUTE_START,      // Call Compute() and Generate().
+    COMPUTE_GEN,        // Start the generated task at idx.
+    NOTIFY              // Notify the successor at link.
+  };
+
+  struct Frame {
+    DynamicNabbitNode* node;
+    FramePhase phase;
+    int idx;
+    DynamicNabbitNode* pred;
+    DynamicNabbitSuccLink* link;
+  };
+
+  DynamicNabbitNode* get_or_insert_task(long long key, bool* inserted);
+  static void run_frames(DynamicNabbitNode* start);
+#endif
+
 };
 
 
 
-// When constructing a DynamicNabbitNode, we need to initialize the blocking
-// array because when a new node n gets put into the hash table, other
-// nodes may block on n, and add themselves to this array, even though
-// n hasn't been expanded yet.
+// When constructing a DynamicNabbitNode, we need to initialize the
+// successor list because when a new node n gets put into the hash
+// table, other nodes may block on n, and add themselves to this list,
+// even though n hasn't been expanded yet.
 DynamicNabbitNode::DynamicNabbitNode(long long k,
 				     TaskGraphHashTable* H_)
   :  key(k),
@@ -121,13 +159,12 @@ DynamicNabbitNode::DynamicNabbitNode(long long k,
      predecessors(NULL),
      status(NODE_UNVISITED),
      join_counter(1),
-     succ_to_notify(new DynamicNabbitNodeArray(4)),
-     generated_tasks(NULL),     
-     blocking_lock(0) {
+     pred_links(NULL),
+     generated_tasks(NULL) {
 }
 
-// The same as the previous construct, except we pass in a default
-// size for the blocking array.
+// The same as the previous constructor.  num_succ used to size the
+// blocking array, and is now ignored.
 
 DynamicNabbitNode::DynamicNabbitNode(long long k,
 				     TaskGraphHashTable* H_,
@@ -137,9 +174,9 @@ DynamicNabbitNode::DynamicNabbitNode(long long k,
      predecessors(NULL),
      status(NODE_UNVISITED),
      join_counter(1),
-     succ_to_notify(new DynamicNabbitNodeArray(num_succ)),
-     generated_tasks(NULL),
-     blocking_lock(0) {
+     pred_links(NULL),
+     generated_tasks(NULL) {
+  (void)num_succ;  // UNUSED parameter.
 }
 
 
@@ -147,8 +184,8 @@ DynamicNabbitNode::~DynamicNabbitNode() {
   if (this->predecessors) {
     delete this->predecessors;
   }
-  if (this->succ_to_notify) {
-    delete this->succ_to_notify;
+  if (this->pred_links) {
+    delete[] this->pred_links;
   }
   if (this->generated_tasks) {
     delete this->generated_tasks;
@@ -156,22 +193,6 @@ DynamicNabbitNode::~DynamicNabbitNode() {
 }
 
 
-bool DynamicNabbitNode::try_acquire_blocking_lock() {
-  bool acquired = false;
-  acquired = nabbit::int_CAS(&this->blocking_lock,
-                             0,
-                             1);
-  return acquired;
-}
-
-void DynamicNabbitNode::acquire_blocking_lock() {
-    nabbit::lock_acquire(&this->blocking_lock);
-}
-
-void DynamicNabbitNode::release_blocking_lock() {
-    nabbit::lock_release(&this->blocking_lock);
-}
-
 bool DynamicNabbitNode::try_mark_as_visited() {
 
     bool valid = nabbit::int_CAS((int*)&this->status,
@@ -226,30 +247,18 @@ void DynamicNabbitNode::mark_as_computed() {
   }
 }
 
-// To switch from computed to completed, we need to be holding the
-// lock on the blocking array.
-bool DynamicNabbitNode::try_mark_as_completed() {
-  bool val = false;
-  acquire_blocking_lock();
-  {
-    if (this->notify_counter == this->succ_to_notify->size_estimate()) {
-        bool valid = nabbit::int_CAS((int*)&this->status,
-                                     NODE_COMPUTED,
-                                     NODE_COMPLETED);
-      assert(valid);
-      val = true;
-    }
-  }
-  release_blocking_lock();
+// Called once every successor in the sealed list has been notified.
+void DynamicNabbitNode::mark_as_completed() {
+  bool valid = nabbit::int_CAS((int*)&this->status,
+                               NODE_COMPUTED,
+                               NODE_COMPLETED);
+  assert(valid);
 
   if (PRINT_STATE_CHANGES) {
-    if (val) {
-      printf("--- Key %lld: marked as COMPLETED. join_counter = %ld\n",
-	     this->key,
-	     this->join_counter);
-    }
+    printf("--- Key %lld: marked as COMPLETED. join_counter = %ld\n",
+	   this->key,
+	   this->join_counter);
   }
-  return val;
 }
 
 DAGNodeStatus DynamicNabbitNode::get_status() {
@@ -270,7 +279,8 @@ void DynamicNabbitNode::generate_task(long long key) {
 /***************************************************************/
 // Methods for constructing the dag statically.
 
-void DynamicNabbitNode::try_init_pred_and_compute(long long pred_key) {
+void DynamicNabbitNode::try_init_pred_and_compute(long long pred_key,
+                                                  DynamicNabbitSuccLink* link) {
 
   bool inserted = false;
   DynamicNabbitNode* actualPredNode;
@@ -288,29 +298,28 @@ void DynamicNabbitNode::try_init_pred_and_compute(long long pred_key) {
     actualPredNode = (DynamicNabbitNode*)H->get_task(pred_key);
   }
 
+  NABBIT_SPAWN_SCOPE;
   if (inserted) {
     //    actualPredNode->mark_as_visited();
 
-    cilk_spawn actualPredNode->init_node_and_compute();
+    NABBIT_SPAWN(actualPredNode->init_node_and_compute());
   }
 
   // Continue, whether or not 
   {
     bool pred_finished = true;
-
-    actualPredNode->acquire_blocking_lock();
     DAGNodeStatus other_status = actualPredNode->status;
 
+    // If the predecessor seals its list before we get on it, it has
+    // been computed, and we count it as finished.
     if (other_status < NODE_COMPUTED) {
-      actualPredNode->succ_to_notify->add(this);
-      pred_finished = false;
+      link->node = this;
+      pred_finished = !actualPredNode->succ_list.try_add(link);
     }
 
 #if NABBIT_PRINT_DEBUG == 1
     printf("inserted = %d. finished? %d\n", inserted, pred_finished);
 #endif
-	   
-    actualPredNode->release_blocking_lock();
 
     if (pred_finished) {
       int val = nabbit::atomic_sub_and_fetch(&this->join_counter,
@@ -320,7 +329,7 @@ void DynamicNabbitNode::try_init_pred_and_compute(long long pred_key) {
 	printf("this node has key %llu. actualPred node has key %llu (should = %llu)\n",
 	       this->key, actualPredNode->key, pred_key);
 	printf("Worker %d, key %llu, enabled at finish_spawn_children\n",
-	       cilk::current_worker_id(),
+	       NABBIT_WKR_ID,
 	       this->key);
 #endif
 	//	cilk_spawn this->compute_and_notify();
@@ -328,13 +337,18 @@ void DynamicNabbitNode::try_init_pred_and_compute(long long pred_key) {
       }
     }
   }
-  cilk_sync;  
+  NABBIT_SYNC;
 }
 
 
 
 void DynamicNabbitNode::init_node_and_compute() {
 
+  // A cancelled evaluation stops expanding.
+  if (CancellationToken::is_cancelled(H->get_cancellation_token())) {
+    return;
+  }
+
   int default_children_count = 4;
   int i;
   this->predecessors = new DTGSKeyArray(default_children_count);
@@ -342,10 +356,17 @@ void DynamicNabbitNode::init_node_and_compute() {
 
   this->mark_as_expanded();
 
+  int num_preds = this->predecessors->size_estimate();
+  if (num_preds > 0) {
+    this->pred_links = new DynamicNabbitSuccLink[num_preds];
+  }
+
   // First try to init + compute predecessors.
-  for (i = 0; i < this->predecessors->size_estimate(); ++i) {
+  NABBIT_SPAWN_SCOPE;
+  for (i = 0; i < num_preds; ++i) {
     long long pred_key = this->predecessors->get(i);
-    cilk_spawn try_init_pred_and_compute(pred_key);
+    DynamicNabbitSuccLink* link = &this->pred_links[i];
+    NABBIT_SPAWN(try_init_pred_and_compute(pred_key, link));
   }
 
   {
@@ -355,6 +376,7 @@ void DynamicNabbitNode::init_node_and_compute() {
       compute_and_notify();
     }
   }
+  NABBIT_SYNC;
 }
 
 
@@ -367,75 +389,256 @@ void DynamicNabbitNode::compute_and_notify() {
 #if NABBIT_PRINT_DEBUG == 1
   printf("COMPUTE AND NOTIFY called on key %llu, worker %d\n",
   	 this->key,
-	 cilk::current_worker_id());
+	 NABBIT_WKR_ID);
 #endif
-  this->Compute();
+  // Once cancelled, enabled nodes drain without computing, and
+  // enable nothing else.
+  CancellationToken* token = H->get_cancellation_token();
+  if (CancellationToken::is_cancelled(token)) {
+    return;
+  }
+  try {
+    this->Compute();
+  }
+  catch (...) {
+    if (token != NULL) {
+      token->cancel();
+    }
+    throw;
+  }
   this->mark_as_computed();
 
   this->generated_tasks = new DTGSKeyArray(4);
   this->Generate();
 
+  NABBIT_SPAWN_SCOPE;
   for (int i = 0; i < this->generated_tasks->size_estimate(); ++i) {
     long long gen_key = this->generated_tasks->get(i);
-    cilk_spawn init_root_and_compute(gen_key);
+    NABBIT_SPAWN(init_root_and_compute(gen_key));
   }
 
-  this->notify_counter = 0;
-  int end_to_notify = 0;
+  DynamicNabbitNode* node = this;
+  SealedSuccList<DynamicNabbitSuccLink>::notify_chunks(
+      this->succ_list.seal(),
+      [node](DynamicNabbitSuccLink* chunk, int count) {
+        node->notify_links(chunk, count);
+      });
+  NABBIT_SYNC;
+
+  // Chunks of the successor list may have been notified in parallel.
+  this->mark_as_completed();
+}
 
 
-  // Keep notifying the children in the blocking array until we
-  // have reached the end of the array.
-  //
-  // Note that the blocking array might grow, as more nodes are
-  // being expanded.  On the other hand, the size of the
-  // blocking array always monotonically increases.  
-  bool done = false;
-  while (!done) {
+// Notifies the count successors in the list starting at link.
+void DynamicNabbitNode::notify_links(DynamicNabbitSuccLink* link, int count) {
+  NABBIT_SPAWN_SCOPE;
+  for (int i = 0; i < count; i++) {
+    DynamicNabbitNode* current_succ = link->node;
+    link = link->next;
 
-    end_to_notify = this->succ_to_notify->size_estimate();
-    
-    // Handle the current range of values in the blocking array.
-    //    cilk_for (int i = this->notify_counter; i < end_to_notify; i++) {
-    for (int i = this->notify_counter; i < end_to_notify; i++) {
-      
-      DynamicNabbitNode* current_succ = this->succ_to_notify->get(i);
-      
-      assert(current_succ->join_counter > 0);
+    assert(current_succ->join_counter > 0);
 
-      assert((current_succ->status == NODE_VISITED) ||
-	     (current_succ->status == NODE_EXPANDED));
+    assert((current_succ->status == NODE_VISITED) ||
+	   (current_succ->status == NODE_EXPANDED));
 
-      int updated_val = nabbit::atomic_sub_and_fetch(&current_succ->join_counter,
-                                                     1);
+    int updated_val = nabbit::atomic_sub_and_fetch(&current_succ->join_counter,
+						   1);
 
-      if (updated_val == 0) {
-	assert((current_succ->status == NODE_EXPANDED));
+    if (updated_val == 0) {
+      assert((current_succ->status == NODE_EXPANDED));
 
-	// The parent node has been EXPANDED.  Now we should
-	// push the parent node onto our deque.
+      // The parent node has been EXPANDED.  Now we should
+      // push the parent node onto our deque.
 
 #if NABBIT_PRINT_DEBUG == 1
-	printf("Worker %d enabling current_succ with key = %llu.  Node's status is %d\n",
-	       cilk::current_worker_id(),
-	       current_succ->key,
-	       current_succ->status);
+      printf("Worker %d enabling current_succ with key = %llu.  Node's status is %d\n",
+	     NABBIT_WKR_ID,
+	     current_succ->key,
+	     current_succ->status);
 #endif
-	cilk_spawn current_succ->compute_and_notify();
-      }
+      NABBIT_SPAWN(current_succ->compute_and_notify());
     }
+  }
+  NABBIT_SYNC;
+}
 
-    this->notify_counter = end_to_notify;
-    
-    // Check to see if we have notified everyone in the
-    // blocking array.
-    done = this->try_mark_as_completed();
+
+#if defined(NABBIT_SERIALIZE)
+
+// Looks up the node for key in the hash table, creating it if it is
+// not there yet.  Sets *inserted if this call created the node.
+DynamicNabbitNode* DynamicNabbitNode::get_or_insert_task(long long key,
+                                                         bool* inserted) {
+  *inserted = false;
+  DynamicNabbitNode* actualNode = (DynamicNabbitNode*)H->get_task(key);
+
+  // Keep trying to insert the node until we get something.
+  while (!actualNode) {
+    *inserted = H->insert_task_if_absent(key);
+    actualNode = (DynamicNabbitNode*)H->get_task(key);
+  }
+  return actualNode;
+}
+
+
+// Runs init_node_and_compute() on start, with every spawn done as a
+// call, in the same order as the serial elision of the recursive
+// methods above.  Successors register on the sealed lists as usual,
+// so the parallel and serialized engines share their bookkeeping.
+void DynamicNabbitNode::run_frames(DynamicNabbitNode* start) {
+
+  std::vector<Frame> stack;
+  Frame first = { start, EXPAND_START, 0, NULL, NULL };
+  stack.push_back(first);
+
+  while (!stack.empty()) {
+    // Copy the frame: pushing a new frame may move the stack.
+    Frame f = stack.back();
+    DynamicNabbitNode* n = f.node;
+    Frame child = { NULL, COMPUTE_START, 0, NULL, NULL };
+
+    switch (f.phase) {
+
+    case EXPAND_START:
+      // A cancelled evaluation stops expanding.
+      if (CancellationToken::is_cancelled(n->H->get_cancellation_token())) {
+        stack.pop_back();
+        break;
+      }
+      n->predecessors = new DTGSKeyArray(4);
+      n->Init();
+      n->mark_as_expanded();
+      if (n->predecessors->size_estimate() > 0) {
+        n->pred_links = new DynamicNabbitSuccLink[n->predecessors->size_estimate()];
+      }
+      stack.back().phase = EXPAND_PREDS;
+      break;
+
+    case EXPAND_PREDS:
+      if (f.idx < n->predecessors->size_estimate()) {
+        bool inserted;
+        DynamicNabbitNode* pred = n->get_or_insert_task(n->predecessors->get(f.idx),
+                                                        &inserted);
+        stack.back().phase = EXPAND_AFTER_PRED;
+        stack.back().pred = pred;
+        if (inserted) {
+          child.node = pred;
+          child.phase = EXPAND_START;
+          stack.push_back(child);
+        }
+      }
+      else {
+        // Done with all the predecessors.
+        if (nabbit::atomic_sub_and_fetch(&n->join_counter, 1) == 0) {
+          stack.back().phase = COMPUTE_START;
+          stack.back().idx = 0;
+        }
+        else {
+          stack.pop_back();
+        }
+      }
+      break;
+
+    case EXPAND_AFTER_PRED:
+      {
+        bool pred_finished = true;
+        stack.back().phase = EXPAND_PREDS;
+        stack.back().idx = f.idx + 1;
+        if (f.pred->status < NODE_COMPUTED) {
+          DynamicNabbitSuccLink* link = &n->pred_links[f.idx];
+          link->node = n;
+          pred_finished = !f.pred->succ_list.try_add(link);
+        }
+        if (pred_finished &&
+            (nabbit::atomic_sub_and_fetch(&n->join_counter, 1) == 0)) {
+          child.node = n;
+          stack.push_back(child);
+        }
+      }
+      break;
+
+    case COMPUTE_START:
+      {
+        // Once cancelled, enabled nodes drain without computing, and
+        // enable nothing else.
+        CancellationToken* token = n->H->get_cancellation_token();
+        if (CancellationToken::is_cancelled(token)) {
+          stack.pop_back();
+          break;
+        }
+        try {
+          n->Compute();
+        }
+        catch (...) {
+          if (token != NULL) {
+            token->cancel();
+          }
+          throw;
+        }
+        n->mark_as_computed();
+
+        n->generated_tasks = new DTGSKeyArray(4);
+        n->Generate();
+        stack.back().phase = COMPUTE_GEN;
+        stack.back().idx = 0;
+      }
+      break;
+
+    case COMPUTE_GEN:
+      if (f.idx < n->generated_tasks->size_estimate()) {
+        bool inserted;
+        stack.back().idx = f.idx + 1;
+        DynamicNabbitNode* gen = n->get_or_insert_task(n->generated_tasks->get(f.idx),
+                                                       &inserted);
+        if (inserted) {
+          child.node = gen;
+          child.phase = EXPAND_START;
+          stack.push_back(child);
+        }
+      }
+      else {
+        stack.back().phase = NOTIFY;
+        stack.back().link = n->succ_list.seal();
+      }
+      break;
+
+    case NOTIFY:
+      if (f.link != NULL) {
+        DynamicNabbitNode* current_succ = f.link->node;
+        stack.back().link = f.link->next;
+
+        assert(current_succ->join_counter > 0);
+        assert((current_succ->status == NODE_VISITED) ||
+               (current_succ->status == NODE_EXPANDED));
+
+        if (nabbit::atomic_sub_and_fetch(&current_succ->join_counter, 1) == 0) {
+          assert((current_succ->status == NODE_EXPANDED));
+          child.node = current_succ;
+          stack.push_back(child);
+        }
+      }
+      else {
+        n->mark_as_completed();
+        stack.pop_back();
+      }
+      break;
+    }
   }
+}
+
 
-  cilk_sync;
-  assert(this->status == NODE_COMPLETED);
+bool DynamicNabbitNode::init_root_and_compute(long long root_key) {
+
+  bool inserted;
+  DynamicNabbitNode* actualNode = get_or_insert_task(root_key, &inserted);
+  if (inserted) {
+    run_frames(actualNode);
+  }
+  return inserted;
 }
 
+#else
 
 bool DynamicNabbitNode::init_root_and_compute(long long root_key) {
 
@@ -448,15 +651,18 @@ bool DynamicNabbitNode::init_root_and_compute(long long root_key) {
     actualNode = (DynamicNabbitNode*)H->get_task(root_key);
   }
 
+  NABBIT_SPAWN_SCOPE;
   if (inserted) {
     //    actualNode->mark_as_visited();
     //    printf("Actually inserted key %llu as a root\n", root_key);
-    cilk_spawn actualNode->init_node_and_compute();
+    NABBIT_SPAWN(actualNode->init_node_and_compute());
   }
-  
+  NABBIT_SYNC;
   return inserted;
 }
 
+#endif
+
 
 
 
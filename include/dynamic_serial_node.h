@@ -35,6 +35,8 @@
 #ifndef __DYNAMIC_SERIAL_NODE_H_
 #define __DYNAMIC_SERIAL_NODE_H_
 
+#include <vector>
+
 #include "dag_status.h"
 #include "dynamic_array.h"
 #include "nabbit_sysdep.h"
@@ -98,9 +100,27 @@ class DynamicSerialNode {
   
   inline void mark_as_completed();
 
-  void try_init_pred_and_compute(long long pred_key); 
-  void init_node_and_compute();
-  void compute_and_notify();
+  // The serial engine walks the DAG using an explicit stack of
+  // frames rather than the call stack.  Each frame records which step
+  // of the recursive traversal a node is on.
+  enum FramePhase {
+    EXPAND_START,       // Call Init() on the node.
+    EXPAND_PREDS,       // Visit the predecessor at idx.
+    EXPAND_AFTER_PRED,  // Done expanding pred; wait on it if needed.
+    COMPUTE_START,      // Call Compute() and Generate().
+    COMPUTE_GEN,        // Start the generated task at idx.
+    NOTIFY              // Notify the successor at idx.
+  };
+
+  struct Frame {
+    DynamicSerialNode* node;
+    FramePhase phase;
+    int idx;
+    DynamicSerialNode* pred;
+  };
+
+  DynamicSerialNode* get_or_insert_task(long long key, bool* inserted);
+  static void run_frames(DynamicSerialNode* start);
 
 };
 
@@ -228,179 +248,179 @@ void DynamicSerialNode::generate_task(long long key) {
 
 
 /***************************************************************/
-// Methods for constructing the dag statically.
-
-void DynamicSerialNode::try_init_pred_and_compute(long long pred_key) {
+// Methods for constructing and computing the dag.
 
-  bool inserted = false;
-  DynamicSerialNode* actualPredNode;
-
-#if DYNAMIC_SERIAL_NABBIT_PRINT_DEBUG == 1
-  printf("inside try_init_pred_and_compute: pred_key = %llu, this->key = %llu\n",
-	 pred_key, this->key);
-#endif
-  
-  actualPredNode = (DynamicSerialNode*)H->get_task(pred_key);
+// Looks up the node for key in the hash table, creating it if it is
+// not there yet.  Sets *inserted if this call created the node.
+DynamicSerialNode* DynamicSerialNode::get_or_insert_task(long long key,
+							 bool* inserted) {
+  *inserted = false;
+  DynamicSerialNode* actualNode = (DynamicSerialNode*)H->get_task(key);
 
   // Keep trying to insert the node until we get something.
-  while (!actualPredNode) {
-    inserted = H->insert_task_if_absent(pred_key);
-    actualPredNode = (DynamicSerialNode*)H->get_task(pred_key);
-  }
-
-  if (inserted) {
-    actualPredNode->init_node_and_compute();
-  }
-  
-  // Continue, whether or not 
-  {
-    bool pred_finished = true;
-    DAGNodeStatus other_status = actualPredNode->status;
-
-    if (other_status < NODE_COMPUTED) {
-      actualPredNode->succ_to_notify->add(this);
-      pred_finished = false;
-    }
-
-#if DYNAMIC_SERIAL_NABBIT_PRINT_DEBUG == 1
-    printf("inserted = %d. finished? %d\n", inserted, pred_finished);
-#endif
-	   
-    if (pred_finished) {
-      this->join_counter--;
-      int val = this->join_counter;      
-      if (val == 0) {
-	this->compute_and_notify();      
-      }
-    }
+  while (!actualNode) {
+    *inserted = H->insert_task_if_absent(key);
+    actualNode = (DynamicSerialNode*)H->get_task(key);
   }
+  return actualNode;
 }
 
 
+// Expands start and everything reachable from it, computing each
+// node once all its predecessors have completed.
+//
+// This is the same depth-first traversal as expanding each
+// predecessor, computing each node and notifying each successor
+// through recursive calls, but the recursion is kept in a stack of
+// frames on the heap, so deep DAGs do not overflow the call stack.
+void DynamicSerialNode::run_frames(DynamicSerialNode* start) {
 
-void DynamicSerialNode::init_node_and_compute() {
+  std::vector<Frame> stack;
+  Frame first = { start, EXPAND_START, 0, NULL };
+  stack.push_back(first);
 
-  int default_children_count = 4;
-  int i;
-  this->predecessors = new DTGSKeyArray(default_children_count);
-  Init();
+  while (!stack.empty()) {
+    // Copy the frame: pushing a new frame may move the stack.
+    Frame f = stack.back();
+    DynamicSerialNode* n = f.node;
+    Frame child = { NULL, COMPUTE_START, 0, NULL };
 
-  this->mark_as_expanded();
+    switch (f.phase) {
 
-  // First try to init + compute predecessors.
-  for (i = 0; i < this->predecessors->size_estimate(); ++i) {
-    long long pred_key = this->predecessors->get(i);
-    try_init_pred_and_compute(pred_key);
-  }
+    case EXPAND_START:
+      n->predecessors = new DTGSKeyArray(4);
+      n->Init();
+      n->mark_as_expanded();
+      stack.back().phase = EXPAND_PREDS;
+      break;
 
-  {
-    int val;
-    this->join_counter--;
-    val = this->join_counter;
-    
-    if (val == 0) {
-      compute_and_notify();
-    }
-  }
-}
-
-
-
-/***************************************************************/
-// Methods which call Compute() and do bookkeepping.
-
-void DynamicSerialNode::compute_and_notify() {
+    case EXPAND_PREDS:
+      if (f.idx < n->predecessors->size_estimate()) {
+	long long pred_key = n->predecessors->get(f.idx);
+	bool inserted;
 
 #if DYNAMIC_SERIAL_NABBIT_PRINT_DEBUG == 1
-  printf("COMPUTE AND NOTIFY called on key %llu, worker %d\n",
-  	 this->key,
-         NABBIT_WKR_ID);
+	printf("expanding pred_key = %llu, this->key = %llu\n",
+	       pred_key, n->key);
 #endif
-  this->Compute();
-  this->mark_as_computed();
-
-  this->generated_tasks = new DTGSKeyArray(4);
-  this->Generate();
-
-  for (int i = 0; i < this->generated_tasks->size_estimate(); ++i) {
-    long long gen_key = this->generated_tasks->get(i);
-    init_root_and_compute(gen_key);
-  }
-
-  this->notify_counter = 0;
-  int end_to_notify = 0;
-
-
-  // Keep notifying the children in the blocking array until we
-  // have reached the end of the array.
-  //
-  // Note that the blocking array might grow, as more nodes are
-  // being expanded.  On the other hand, the size of the
-  // blocking array always monotonically increases.  
-  bool done = false;
-  while (!done) {
+	DynamicSerialNode* pred = n->get_or_insert_task(pred_key, &inserted);
+	stack.back().phase = EXPAND_AFTER_PRED;
+	stack.back().pred = pred;
+	if (inserted) {
+	  child.node = pred;
+	  child.phase = EXPAND_START;
+	  stack.push_back(child);
+	}
+      }
+      else {
+	// Done with all the predecessors.
+	n->join_counter--;
+	if (n->join_counter == 0) {
+	  stack.back().phase = COMPUTE_START;
+	  stack.back().idx = 0;
+	}
+	else {
+	  stack.pop_back();
+	}
+      }
+      break;
 
-    end_to_notify = this->succ_to_notify->size_estimate();
-    
-    // Handle the current range of values in the blocking array.
-    for (int i = this->notify_counter; i < end_to_notify; i++) {
-      
-      DynamicSerialNode* current_succ = this->succ_to_notify->get(i);
-      
-      assert(current_succ->join_counter > 0);
+    case EXPAND_AFTER_PRED:
+      stack.back().phase = EXPAND_PREDS;
+      stack.back().idx = f.idx + 1;
+      if (f.pred->status < NODE_COMPUTED) {
+	f.pred->succ_to_notify->add(n);
+      }
+      else {
+	n->join_counter--;
+	if (n->join_counter == 0) {
+	  child.node = n;
+	  stack.push_back(child);
+	}
+      }
+      break;
 
-      assert((current_succ->status == NODE_VISITED) ||
-	     (current_succ->status == NODE_EXPANDED));
+    case COMPUTE_START:
+#if DYNAMIC_SERIAL_NABBIT_PRINT_DEBUG == 1
+      printf("COMPUTE AND NOTIFY called on key %llu, worker %d\n",
+	     n->key,
+	     NABBIT_WKR_ID);
+#endif
+      n->Compute();
+      n->mark_as_computed();
+
+      n->generated_tasks = new DTGSKeyArray(4);
+      n->Generate();
+      stack.back().phase = COMPUTE_GEN;
+      stack.back().idx = 0;
+      break;
+
+    case COMPUTE_GEN:
+      if (f.idx < n->generated_tasks->size_estimate()) {
+	long long gen_key = n->generated_tasks->get(f.idx);
+	bool inserted;
+	stack.back().idx = f.idx + 1;
+	DynamicSerialNode* gen = n->get_or_insert_task(gen_key, &inserted);
+	if (inserted) {
+	  child.node = gen;
+	  child.phase = EXPAND_START;
+	  stack.push_back(child);
+	}
+      }
+      else {
+	n->notify_counter = 0;
+	stack.back().phase = NOTIFY;
+	stack.back().idx = 0;
+      }
+      break;
 
-      current_succ->join_counter--;
-      int updated_val = current_succ->join_counter;
+    case NOTIFY:
+      // The node is already COMPUTED, so nothing new can be added to
+      // its blocking array while we notify.
+      if (f.idx < n->succ_to_notify->size_estimate()) {
+	DynamicSerialNode* current_succ = n->succ_to_notify->get(f.idx);
+	stack.back().idx = f.idx + 1;
 
-      if (updated_val == 0) {
-	assert((current_succ->status == NODE_EXPANDED));
+	assert(current_succ->join_counter > 0);
+	assert((current_succ->status == NODE_VISITED) ||
+	       (current_succ->status == NODE_EXPANDED));
 
-	// The parent node has been EXPANDED.  Now we should
-	// push the parent node onto our deque.
+	current_succ->join_counter--;
+	if (current_succ->join_counter == 0) {
+	  assert((current_succ->status == NODE_EXPANDED));
 
 #if DYNAMIC_SERIAL_NABBIT_PRINT_DEBUG == 1
-	printf("Worker %d enabling current_succ with key = %llu.  Node's status is %d\n",
-               NABBIT_WKR_ID, 
-	       current_succ->key,
-	       current_succ->status);
+	  printf("Worker %d enabling current_succ with key = %llu.  Node's status is %d\n",
+		 NABBIT_WKR_ID,
+		 current_succ->key,
+		 current_succ->status);
 #endif
-	current_succ->compute_and_notify();
+	  child.node = current_succ;
+	  stack.push_back(child);
+	}
       }
+      else {
+	n->notify_counter = f.idx;
+	n->mark_as_completed();
+	assert(n->status == NODE_COMPLETED);
+	stack.pop_back();
+      }
+      break;
     }
-
-    this->notify_counter = end_to_notify;
-    
-    // Check to see if we have notified everyone in the
-    // blocking array.
-
-    //    done = this->try_mark_as_completed();
-    this->mark_as_completed();
-    done = true;
   }
-
-  assert(this->status == NODE_COMPLETED);
 }
 
 
 bool DynamicSerialNode::init_root_and_compute(long long root_key) {
 
-  bool inserted = false;
-  DynamicSerialNode* actualNode = (DynamicSerialNode*)H->get_task(root_key);
-  
-  // Keep trying to insert the node until we get something.
-  while (!actualNode) {
-    inserted = H->insert_task_if_absent(root_key);
-    actualNode = (DynamicSerialNode*)H->get_task(root_key);
-  }
+  bool inserted;
+  DynamicSerialNode* actualNode = get_or_insert_task(root_key, &inserted);
 
   if (inserted) {
 
     //    printf("Actually inserted key %llu as a root\n", root_key);
 
-    actualNode->init_node_and_compute();
+    run_frames(actualNode);
   }  
   return inserted;
 }
@@ -0,0 +1,220 @@
+/* memory_budget.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef __MEMORY_BUDGET_H_
+#define __MEMORY_BUDGET_H_
+
+/**
+ * A budget for the memory used by running static Nabbit nodes.
+ *
+ * Each StaticNabbitNode can declare an estimate of the memory its
+ * Compute() uses, with set_memory_estimate().  With a MemoryBudget
+ * attached (StaticDAG::set_memory_budget()), a node that is enabled
+ * while the running nodes' estimates would push the total over the
+ * limit is parked instead of run.  When a node finishes Compute(), it
+ * returns its memory to the budget, and resumes as many parked nodes
+ * as now fit, in the order they were parked.
+ *
+ * A node is always admitted when nothing else is running, so a node
+ * whose estimate alone is over the limit still runs, by itself.
+ *
+ * Admitting and releasing a node are a CAS on the total while no node
+ * is parked.  Parked nodes are kept in per-worker queues, each under
+ * its own lock: a worker parks nodes in its own queue, and a release
+ * resumes nodes from its own queue first, then from the others.
+ * Nodes resume in the order they were parked within each queue, but
+ * not across queues.
+ */
+
+#include <assert.h>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "nabbit_sysdep.h"
+
+class StaticNabbitNode;
+
+class MemoryBudget {
+
+ public:
+  MemoryBudget(long long limit);
+
+  long long get_limit() { return this->limit; }
+  long long get_in_use() { return this->in_use.load(); }
+
+  // The largest total of the estimates of admitted nodes so far.
+  long long get_peak() { return this->peak.load(); }
+  void reset_peak() { this->peak.store(this->in_use.load()); }
+
+  // Returns true if node, with estimate bytes, may run now.  Otherwise
+  // parks it, and returns false.  Either way, appends any other
+  // parked nodes that may run now to resumed.
+  bool admit(StaticNabbitNode* node, long long bytes,
+             std::vector<StaticNabbitNode*>* resumed);
+
+  // Returns the estimate bytes of a node that finished, and appends
+  // the parked nodes that now fit to resumed.
+  void release(long long bytes, std::vector<StaticNabbitNode*>* resumed);
+
+ private:
+  struct Parked {
+    StaticNabbitNode* node;
+    long long bytes;
+  };
+
+  // Worker w parks nodes in queues[w+1].  queues[0] is for threads
+  // that are not workers, and for workers beyond the count the
+  // queues were sized for (if the executor changed since).
+  struct ParkedQueue {
+    int lock;
+    std::deque<Parked> parked;
+    char padding[64];
+  };
+
+  long long limit;
+  std::atomic<long long> in_use;
+  std::atomic<long long> peak;
+  std::atomic<long> num_parked;
+  std::vector<ParkedQueue> queues;
+
+  inline int local_queue();
+  bool try_reserve(long long bytes);
+  void resume_parked(ParkedQueue* q, std::vector<StaticNabbitNode*>* resumed);
+};
+
+
+MemoryBudget::MemoryBudget(long long limit_)
+  : limit(limit_),
+    in_use(0),
+    peak(0),
+    num_parked(0) {
+  assert(limit_ > 0);
+  int P = NABBIT_WKR_COUNT;
+  this->queues.resize((P > 0 ? P : 0) + 1);
+  for (size_t i = 0; i < this->queues.size(); i++) {
+    this->queues[i].lock = 0;
+  }
+}
+
+
+int MemoryBudget::local_queue() {
+  int w = NABBIT_WKR_ID;
+  if ((w >= 0) && ((size_t)w + 1 < this->queues.size())) {
+    return w + 1;
+  }
+  return 0;
+}
+
+// Adds bytes to the total, if it fits or nothing is running.
+bool MemoryBudget::try_reserve(long long bytes) {
+  long long cur = this->in_use.load();
+  do {
+    if ((cur != 0) && (cur + bytes > this->limit)) {
+      return false;
+    }
+  } while (!this->in_use.compare_exchange_weak(cur, cur + bytes));
+
+  long long p = this->peak.load();
+  while ((cur + bytes > p) &&
+         !this->peak.compare_exchange_weak(p, cur + bytes)) {
+  }
+  return true;
+}
+
+// Moves parked nodes in q that fit to resumed, oldest first.  Must
+// hold q's lock.
+void MemoryBudget::resume_parked(ParkedQueue* q,
+                                 std::vector<StaticNabbitNode*>* resumed) {
+  while (!q->parked.empty() &&
+         this->try_reserve(q->parked.front().bytes)) {
+    resumed->push_back(q->parked.front().node);
+    q->parked.pop_front();
+    this->num_parked--;
+  }
+}
+
+
+bool MemoryBudget::admit(StaticNabbitNode* node, long long bytes,
+                         std::vector<StaticNabbitNode*>* resumed) {
+  // Parked nodes go first.
+  if ((this->num_parked.load() == 0) && this->try_reserve(bytes)) {
+    return true;
+  }
+
+  ParkedQueue* q = &this->queues[this->local_queue()];
+  nabbit::lock_acquire(&q->lock);
+  Parked p = { node, bytes };
+  q->parked.push_back(p);
+  this->num_parked++;
+
+  // A release that did not see this node parked has lowered the
+  // total first, so retrying here cannot miss it.  Nodes parked in
+  // other queues before this one were counted in num_parked, so any
+  // release since then looks at their queues itself.
+  bool admitted = false;
+  size_t start = resumed->size();
+  this->resume_parked(q, resumed);
+  for (size_t i = start; i < resumed->size(); i++) {
+    if ((*resumed)[i] == node) {
+      admitted = true;
+      resumed->erase(resumed->begin() + i);
+      break;
+    }
+  }
+  nabbit::lock_release(&q->lock);
+  return admitted;
+}
+
+
+void MemoryBudget::release(long long bytes,
+                           std::vector<StaticNabbitNode*>* resumed) {
+  this->in_use -= bytes;
+  assert(this->in_use.load() >= 0);
+  if (this->num_parked.load() == 0) {
+    return;
+  }
+
+  // Local queue first, then the others in turn.
+  int n = (int)this->queues.size();
+  int first = this->local_queue();
+  for (int i = 0; (i < n) && (this->num_parked.load() > 0); i++) {
+    ParkedQueue* q = &this->queues[(first + i) % n];
+    nabbit::lock_acquire(&q->lock);
+    this->resume_parked(q, resumed);
+    nabbit::lock_release(&q->lock);
+  }
+}
+
+#endif // __MEMORY_BUDGET_H_
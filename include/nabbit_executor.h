@@ -0,0 +1,342 @@
+/* nabbit_executor.h                      -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __NABBIT_EXECUTOR_H_
+#define __NABBIT_EXECUTOR_H_
+
+/**
+ * The interface between Nabbit and the runtime which executes its
+ * tasks.
+ *
+ * With the default (native) build, NABBIT_SPAWN_SCOPE, NABBIT_SPAWN
+ * and NABBIT_SYNC operate on a TaskGroup, which forwards to the
+ * current Executor.  An Executor only needs to provide spawn and
+ * sync for a group of tasks, a worker id and count, and a way to run
+ * a function inside its thread pool.  This lets Nabbit share the
+ * thread pool of a host application instead of starting its own.
+ *
+ * Executors provided:
+ *   "native"  The std::thread scheduler from native_scheduler.h.
+ *   "openmp"  OpenMP task / taskwait (omp_executor.h), when compiled
+ *             with OpenMP enabled.
+ *   "tbb"     oneTBB task_group (tbb_executor.h), when compiled with
+ *             NABBIT_HAVE_TBB.
+ *
+ * The current executor defaults to the one named by the
+ * NABBIT_EXECUTOR environment variable, or "native" otherwise.  It
+ * can be changed with set_executor(), but only while no task graph
+ * is running.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <new>
+#include <utility>
+
+#include "native_scheduler.h"
+
+namespace nabbit {
+
+  // Size of the storage a TaskGroup reserves for its executor.
+  // Executors with larger per-group state allocate it separately.
+  const int EXECUTOR_GROUP_STATE_WORDS = 8;
+
+  class Executor {
+   public:
+    virtual ~Executor() { }
+
+    virtual const char* name() const = 0;
+
+    // Id of the calling worker, in [0, worker_count()).  Returns a
+    // negative value for a thread that is not part of the executor.
+    virtual int worker_id() = 0;
+    virtual int worker_count() = 0;
+
+    // Runs f on the calling thread, inside the executor's thread
+    // pool, and returns once f does.  Entry points (e.g.,
+    // source_compute()) should be called from inside execute() for
+    // executors that have no implicit pool, such as OpenMP.
+    virtual void execute(const std::function<void()>& f) = 0;
+
+    // Task groups.  state points to EXECUTOR_GROUP_STATE_WORDS words
+    // of storage owned by a TaskGroup.  group_wait() waits for every
+    // task spawned into the group, destroys the state, and returns
+    // the first exception thrown by a task, if any.
+    virtual void group_init(void* state) = 0;
+    virtual void group_spawn(void* state, std::function<void()>&& f) = 0;
+    virtual std::exception_ptr group_wait(void* state) = 0;
+
+    // Spawns f into the group, preferably on worker (worker %
+    // worker_count()).  The hint may be ignored; by default it is.
+    virtual void group_spawn_at(void* state, int worker,
+                                std::function<void()>&& f) {
+      (void)worker;
+      group_spawn(state, std::move(f));
+    }
+
+    // Calls chunk(a, b) on disjoint subranges covering [lo, hi), each
+    // at most roughly grain long.  The default implementation splits
+    // the range recursively using task groups.
+    virtual void parallel_for(long lo, long hi, long grain,
+                              const std::function<void(long, long)>& chunk);
+  };
+
+
+  inline Executor* current_executor();
+
+
+  // The set of tasks spawned from one function frame, on the
+  // executor that was current when the group was created.  As with
+  // NativeTaskGroup, the group syncs when it goes out of scope.
+  //
+  // An exception from a task that was never synced explicitly is
+  // rethrown by the implicit sync on scope exit, so that it reaches
+  // the enclosing group's sync.  If the scope is already unwinding
+  // from another exception, that one wins, just as the first of
+  // several task exceptions does.
+  class TaskGroup {
+   public:
+    TaskGroup()
+      : exec(current_executor()),
+        active(false) { }
+
+    ~TaskGroup() noexcept(false) {
+      if (active) {
+        active = false;
+        std::exception_ptr e = exec->group_wait(state);
+        if (e && !std::uncaught_exception()) {
+          std::rethrow_exception(e);
+        }
+      }
+    }
+
+    template <class F>
+    void spawn(const F& f) {
+      if (!active) {
+        exec->group_init(state);
+        active = true;
+      }
+      exec->group_spawn(state, std::function<void()>(f));
+    }
+
+    // Same as spawn(), with a hint for the worker that should run f.
+    template <class F>
+    void spawn_at(int worker, const F& f) {
+      if (!active) {
+        exec->group_init(state);
+        active = true;
+      }
+      exec->group_spawn_at(state, worker, std::function<void()>(f));
+    }
+
+    // Rethrows the first exception thrown by a task in the group.
+    void sync() {
+      if (active) {
+        active = false;
+        std::exception_ptr e = exec->group_wait(state);
+        if (e) {
+          std::rethrow_exception(e);
+        }
+      }
+    }
+
+   private:
+    Executor* exec;
+    bool active;
+    void* state[EXECUTOR_GROUP_STATE_WORDS];
+  };
+
+
+  inline void Executor::parallel_for(long lo, long hi, long grain,
+                                     const std::function<void(long, long)>& chunk) {
+    TaskGroup group;
+    while (hi - lo > grain) {
+      long mid = lo + (hi - lo) / 2;
+      group.spawn([=, &chunk]() {
+          this->parallel_for(mid, hi, grain, chunk);
+        });
+      hi = mid;
+    }
+    if (lo < hi) {
+      chunk(lo, hi);
+    }
+    group.sync();
+  }
+
+
+  class NativeExecutor : public Executor {
+   public:
+    const char* name() const { return "native"; }
+
+    int worker_id() {
+      return NativeScheduler::current_worker_id();
+    }
+
+    int worker_count() {
+      return NativeScheduler::current_worker_count();
+    }
+
+    void execute(const std::function<void()>& f) {
+      f();
+    }
+
+    void group_init(void* state) {
+      static_assert(sizeof(NativeTaskGroup) <= sizeof(void*) * EXECUTOR_GROUP_STATE_WORDS,
+                    "NativeTaskGroup does not fit in a TaskGroup");
+      new (state) NativeTaskGroup();
+    }
+
+    void group_spawn(void* state, std::function<void()>&& f) {
+      static_cast<NativeTaskGroup*>(state)->spawn(std::move(f));
+    }
+
+    void group_spawn_at(void* state, int worker, std::function<void()>&& f) {
+      static_cast<NativeTaskGroup*>(state)->spawn_at(worker, std::move(f));
+    }
+
+    std::exception_ptr group_wait(void* state) {
+      NativeTaskGroup* g = static_cast<NativeTaskGroup*>(state);
+      std::exception_ptr e = g->sync_and_take_error();
+      g->~NativeTaskGroup();
+      return e;
+    }
+  };
+};
+
+
+#ifdef _OPENMP
+#   include "omp_executor.h"
+#endif
+
+#ifdef NABBIT_HAVE_TBB
+#   include "tbb_executor.h"
+#endif
+
+
+namespace nabbit {
+
+  // Names of the executors compiled into this build.
+  inline const char* const* executor_names() {
+    static const char* const names[] = {
+      "native",
+#ifdef _OPENMP
+      "openmp",
+#endif
+#ifdef NABBIT_HAVE_TBB
+      "tbb",
+#endif
+      NULL
+    };
+    return names;
+  }
+
+  // Returns the executor with the given name, or NULL if it is not
+  // compiled into this build.  Each executor is created on first use.
+  inline Executor* find_executor(const char* name) {
+    if (strcmp(name, "native") == 0) {
+      static NativeExecutor native_exec;
+      return &native_exec;
+    }
+#ifdef _OPENMP
+    if (strcmp(name, "openmp") == 0) {
+      static OpenMPExecutor omp_exec;
+      return &omp_exec;
+    }
+#endif
+#ifdef NABBIT_HAVE_TBB
+    if (strcmp(name, "tbb") == 0) {
+      static TBBExecutor tbb_exec;
+      return &tbb_exec;
+    }
+#endif
+    return NULL;
+  }
+
+  inline std::atomic<Executor*>& current_executor_slot() {
+    static std::atomic<Executor*> exec(NULL);
+    return exec;
+  }
+
+  inline Executor* default_executor() {
+    const char* env = getenv("NABBIT_EXECUTOR");
+    Executor* exec = NULL;
+    if (env != NULL) {
+      exec = find_executor(env);
+    }
+    if (exec == NULL) {
+      exec = find_executor("native");
+    }
+    return exec;
+  }
+
+  inline Executor* current_executor() {
+    Executor* exec = current_executor_slot().load(std::memory_order_acquire);
+    if (exec == NULL) {
+      static Executor* default_exec = default_executor();
+      exec = default_exec;
+      current_executor_slot().store(exec, std::memory_order_release);
+    }
+    return exec;
+  }
+
+  // Makes exec the current executor.  Must not be called while tasks
+  // are running.
+  inline void set_executor(Executor* exec) {
+    assert(exec != NULL);
+    current_executor_slot().store(exec, std::memory_order_release);
+  }
+
+  // Switches to the executor with the given name.  Returns false (and
+  // leaves the current executor unchanged) if there is no such
+  // executor in this build.
+  inline bool set_executor(const char* name) {
+    Executor* exec = find_executor(name);
+    if (exec == NULL) {
+      return false;
+    }
+    set_executor(exec);
+    return true;
+  }
+
+  // Runs f inside the current executor.
+  template <class F>
+  inline void execute(const F& f) {
+    current_executor()->execute(std::function<void()>(f));
+  }
+};
+
+#endif // __NABBIT_EXECUTOR_H_
@@ -50,17 +50,15 @@
 
 #include "static_serial_node.h"
 #include "static_nabbit_node.h"
+#include "static_reduction_node.h"
 #include "dynamic_serial_node.h"
 #include "dynamic_nabbit_node.h"
+#include "static_dag.h"
+#include "static_dag_builder.h"
+#include "online_nabbit_node.h"
+#include "online_dag.h"
 
 
-// Possible status for a node.
-typedef enum { SERIAL_STATIC_TRAVERSAL=0,
-	       STATIC_NABBIT_TRAVERSAL=1,
-	       SERIAL_DYNAMIC_TRAVERSAL=2,
-	       DYNAMIC_NABBIT_TRAVERSAL=3
-} DAGTraversalType;
-
 
 // The supported types of nodes: 
 //
@@ -68,6 +66,10 @@ typedef enum { SERIAL_STATIC_TRAVERSAL=0,
 // 2. StaticNabbitNode
 // 3. DynamicSerialNode
 // 4. DynamicNabbitNode
+//
+// DAGTraversalType, in dag_status.h, names the engine of each.  A
+// StaticDAG of StaticNabbitNodes can also pick between the first two
+// at runtime; see StaticDAG::choose_traversal().
 
 
 template <class NodeType>
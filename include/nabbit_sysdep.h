@@ -35,6 +35,39 @@
  * This file defines some macros, etc. for dealing with different
  * versions of Cilk and other generally sysdep-dependent functions.
  *
+ * Parallel code in Nabbit uses the following macros instead of the
+ * Cilk keywords directly:
+ *
+ *   NABBIT_SPAWN_SCOPE   Declares the set of spawns for the current
+ *                        function.  Must appear before NABBIT_SPAWN.
+ *   NABBIT_SPAWN(call)   Spawns "call".  Arguments are evaluated
+ *                        (copied) at the point of the spawn.
+ *   NABBIT_SPAWN_ASSIGN(x, call)
+ *                        Spawns "x = call".  x must stay live
+ *                        until the next sync.
+ *   NABBIT_SPAWN_AT(w, call)
+ *                        Spawns "call", preferably on worker
+ *                        (w % NABBIT_WKR_COUNT).  w < 0 means no
+ *                        preference.  Only a hint; w may not even
+ *                        be evaluated.
+ *   NABBIT_SYNC          Waits for all spawns in the current scope.
+ *                        As in Cilk, the scope also syncs on exit.
+ *   NABBIT_WKR_ID        The id of the current worker.
+ *   NABBIT_WKR_COUNT     The total number of workers.
+ *
+ * and nabbit::parallel_for(lo, hi, body) in place of cilk_for.
+ * Top-level parallel code should be started with nabbit::execute(f),
+ * so that it runs inside the executor's thread pool.
+ *
+ * The runtime behind these macros is selected at build time:
+ *
+ *   NABBIT_SERIALIZE     Serial elision: spawns become calls.
+ *   NABBIT_USE_CILK      Intel Cilk Plus.
+ *   (default)            The executor chosen at runtime, which is
+ *                        the native std::thread work-stealing
+ *                        scheduler unless set otherwise.  See
+ *                        nabbit_executor.h.
+ *
  *
  * TBD(jsukha): My implementation is terrible.  
  * We need to go through and replace many of these functions
@@ -45,17 +78,63 @@
 #define __NABBIT_SYSDEP_H_
 
 
+#include <assert.h>
+
+#include <stdlib.h>
+
 #ifdef _WIN32
+#   include <malloc.h>
 #   include <windows.h>
+#else
+#   include <sched.h>
 #endif
 
 
+#if defined(NABBIT_SERIALIZE)
+
+#   define NABBIT_WKR_ID 0
+#   define NABBIT_WKR_COUNT 1
+#   define NABBIT_SPAWN_SCOPE
+#   define NABBIT_SPAWN(...) __VA_ARGS__
+#   define NABBIT_SPAWN_AT(w, ...) __VA_ARGS__
+#   define NABBIT_SPAWN_ASSIGN(x, ...) (x) = __VA_ARGS__
+#   define NABBIT_SYNC
+
+#elif defined(NABBIT_USE_CILK)
+
 // Intel Cilk Plus definitions.
-#include <cilk/cilk.h>
-#include <cilk/cilk_api.h>
+#   include <cilk/cilk.h>
+#   include <cilk/cilk_api.h>
+
+#   define NABBIT_WKR_ID __cilkrts_get_worker_number()
+#   define NABBIT_WKR_COUNT __cilkrts_get_nworkers()
+#   define NABBIT_SPAWN_SCOPE
+#   define NABBIT_SPAWN(...) cilk_spawn __VA_ARGS__
+#   define NABBIT_SPAWN_AT(w, ...) cilk_spawn __VA_ARGS__
+#   define NABBIT_SPAWN_ASSIGN(x, ...) (x) = cilk_spawn __VA_ARGS__
+#   define NABBIT_SYNC cilk_sync
+
+#else
+
+// Executor definitions.  The executors are included at the end of
+// this file, since they use the functions below.
+#   define NABBIT_WKR_ID nabbit::current_executor()->worker_id()
+#   define NABBIT_WKR_COUNT nabbit::current_executor()->worker_count()
+#   define NABBIT_SPAWN_SCOPE nabbit::TaskGroup nabbit_spawn_scope_
+#   define NABBIT_SPAWN(...) nabbit_spawn_scope_.spawn([=]() { __VA_ARGS__; })
+#   define NABBIT_SPAWN_AT(w, ...)                                     \
+    nabbit_spawn_scope_.spawn_at((w), [=]() { __VA_ARGS__; })
+#   define NABBIT_SPAWN_ASSIGN(x, ...)                                 \
+    do {                                                                \
+        auto nabbit_spawn_dest_ = &(x);                                 \
+        nabbit_spawn_scope_.spawn([=]() {                               \
+                *nabbit_spawn_dest_ = __VA_ARGS__;                      \
+            });                                                         \
+    } while (0)
+#   define NABBIT_SYNC nabbit_spawn_scope_.sync()
+#   define NABBIT_HAS_EXECUTORS 1
 
-#define NABBIT_WKR_ID __cilkrts_get_worker_number()
-#define NABBIT_WKR_COUNT __cilkrts_get_nworkers()
+#endif
 
 
 namespace nabbit {
@@ -104,9 +183,18 @@ namespace nabbit {
         Sleep(0);
     }
 
+    // Returns size bytes aligned to align (a power of two), or NULL.
+    // Free with aligned_free().
+    inline void* aligned_malloc(size_t size, size_t align) {
+        return _aligned_malloc(size, align);
+    }
+
+    inline void aligned_free(void* p) {
+        _aligned_free(p);
+    }
+
 #else
     // GCC-compatible systems.
-#include <pthread.h>
 
     inline long atomic_add_and_fetch(long volatile* p, long x) {
         return __sync_add_and_fetch(p, x);
@@ -133,7 +221,19 @@ namespace nabbit {
     }
 
     inline void system_yield() {
-        pthread_yield();
+        sched_yield();
+    }
+
+    inline void* aligned_malloc(size_t size, size_t align) {
+        void* p = NULL;
+        if (posix_memalign(&p, align, size) != 0) {
+            return NULL;
+        }
+        return p;
+    }
+
+    inline void aligned_free(void* p) {
+        free(p);
     }
     
 #endif
@@ -173,6 +273,75 @@ namespace nabbit {
 
 
 
+#if defined(NABBIT_HAS_EXECUTORS)
+#   include "nabbit_executor.h"
+#endif
+
+namespace nabbit {
+
+#if !defined(NABBIT_HAS_EXECUTORS)
+    // Without executors, code simply runs on the calling thread (or
+    // Cilk worker).
+    template <class F>
+    inline void execute(const F& f) {
+        f();
+    }
+#endif
+
+    // Runs body(i) for each i in [lo, hi), in parallel.
+    template <class F>
+    inline void parallel_for(long lo, long hi, const F& body) {
+#if defined(NABBIT_SERIALIZE)
+        for (long i = lo; i < hi; i++) {
+            body(i);
+        }
+#elif defined(NABBIT_USE_CILK)
+        cilk_for (long i = lo; i < hi; i++) {
+            body(i);
+        }
+#else
+        // Same default grain size as cilk_for.
+        long grain = (hi - lo) / (8 * NABBIT_WKR_COUNT);
+        if (grain > 2048) {
+            grain = 2048;
+        }
+        if (grain < 1) {
+            grain = 1;
+        }
+        current_executor()->parallel_for(lo, hi, grain,
+                                         [&body](long a, long b) {
+                                             for (long i = a; i < b; i++) {
+                                                 body(i);
+                                             }
+                                         });
+#endif
+    }
+
+
+    // Nabbit nodes with more than this many successors to notify
+    // split them up with divide-and-conquer spawning, instead of
+    // notifying them in one serial loop.  Can be changed at run time,
+    // but not while a DAG is running.
+#ifndef NABBIT_PARALLEL_NOTIFY_THRESHOLD
+#   define NABBIT_PARALLEL_NOTIFY_THRESHOLD 512
+#endif
+
+    inline int& parallel_notify_threshold_slot() {
+        static int threshold = NABBIT_PARALLEL_NOTIFY_THRESHOLD;
+        return threshold;
+    }
+
+    inline int parallel_notify_threshold() {
+        return parallel_notify_threshold_slot();
+    }
+
+    inline void set_parallel_notify_threshold(int threshold) {
+        assert(threshold > 0);
+        parallel_notify_threshold_slot() = threshold;
+    }
+};
+
+
 // For now, I'm deprecating the support for Cilk++.
 // Given that Cilk++ is no longer supported by anyone, I'm not sure
 // there is much point in keeping it...
@@ -0,0 +1,500 @@
+/* native_scheduler.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __NATIVE_SCHEDULER_H_
+#define __NATIVE_SCHEDULER_H_
+
+/**
+ * A small work-stealing scheduler built on std::thread, used in place
+ * of the Cilk Plus runtime.
+ *
+ * The scheduler runs one thread per worker.  The first thread to use
+ * the scheduler (normally the main thread) becomes worker 0, and the
+ * remaining P-1 workers are started in the background.  P is read
+ * from NABBIT_NWORKERS, then CILK_NWORKERS, and otherwise defaults to
+ * the number of hardware threads.
+ *
+ * Each worker owns a Chase-Lev deque.  A spawn pushes a task onto the
+ * bottom of the current worker's deque.  An idle worker picks a victim
+ * at random and steals from the top of its deque; on a successful
+ * steal, it also takes up to half of the victim's remaining tasks
+ * (bounded by NATIVE_STEAL_BATCH) and pushes them onto its own deque.
+ *
+ * Unlike Cilk, the scheduler is "help-first": the spawning worker
+ * continues with the code after the spawn, and a worker blocked at a
+ * sync executes other tasks (its own first, then stolen ones) until
+ * all the tasks spawned in its NativeTaskGroup have finished.
+ *
+ * Threads that are not workers may still spawn; their tasks are
+ * executed immediately, as if the spawn were elided.
+ *
+ * A spawn may also name a preferred worker.  If that is not the
+ * spawning worker, the task goes into the preferred worker's
+ * mailbox, which the worker checks whenever its own deque is empty.
+ * Thieves that find a victim's deque empty take its mailbox instead,
+ * so a mailed task never waits on a busy worker for long.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "nabbit_sysdep.h"
+#include "work_stealing_deque.h"
+
+namespace nabbit {
+
+  // Initial capacity of each worker's deque.
+  const int NATIVE_DEQUE_INIT_CAPACITY = 256;
+
+  // Maximum number of tasks taken in one steal.
+  const int NATIVE_STEAL_BATCH = 4;
+
+  // Number of failed steal attempts before an idle worker starts
+  // yielding, and then before it goes to sleep.
+  const int NATIVE_SPIN_LIMIT = 256;
+  const int NATIVE_YIELD_LIMIT = 2048;
+
+
+  // Number of workers requested through NABBIT_NWORKERS (or
+  // CILK_NWORKERS), or 0 if neither is set.
+  inline int requested_worker_count() {
+    const char* env = getenv("NABBIT_NWORKERS");
+    if (env == NULL) {
+      env = getenv("CILK_NWORKERS");
+    }
+    if (env != NULL) {
+      int p = atoi(env);
+      if (p > 0) {
+        return p;
+      }
+    }
+    return 0;
+  }
+
+
+  class NativeTaskGroup;
+
+  class NativeTask {
+   public:
+    NativeTaskGroup* group;
+    // Next task in the mailbox this task was mailed to.
+    NativeTask* next_mail;
+
+    NativeTask() : group(NULL), next_mail(NULL) { }
+    virtual ~NativeTask() { }
+    virtual void execute() = 0;
+  };
+
+  template <class F>
+  class NativeFunctorTask : public NativeTask {
+   public:
+    NativeFunctorTask(F&& f_) : f(std::move(f_)) { }
+    NativeFunctorTask(const F& f_) : f(f_) { }
+    void execute() { f(); }
+
+   private:
+    F f;
+  };
+
+
+  struct NativeWorker {
+    int id;
+    unsigned int rand_state;
+    WorkStealingDeque<NativeTask*> deque;
+    // Tasks mailed to this worker by other workers, as a stack.
+    std::atomic<NativeTask*> mailbox;
+    char padding[64];
+
+    NativeWorker()
+      : id(-1),
+        rand_state(1),
+        deque(NATIVE_DEQUE_INIT_CAPACITY),
+        mailbox(NULL) { }
+
+    // xorshift random number generator, for choosing victims.
+    unsigned int next_rand() {
+      unsigned int x = rand_state;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      rand_state = x;
+      return x;
+    }
+  };
+
+
+  // The set of tasks spawned from one function frame.  sync() returns
+  // once all of them have completed.  If any of the tasks threw an
+  // exception, the first one is rethrown from sync().
+  class NativeTaskGroup {
+   public:
+    std::atomic<long> pending;
+
+    NativeTaskGroup()
+      : pending(0),
+        has_error(false),
+        has_error_claim(false) { }
+
+    // Cilk functions sync implicitly on return.  Mirror that here.
+    ~NativeTaskGroup() {
+      wait();
+    }
+
+    template <class F>
+    void spawn(F&& f);
+
+    // Spawns f, preferably on worker (worker % P).  A negative worker
+    // means no preference.
+    template <class F>
+    void spawn_at(int worker, F&& f);
+
+    void sync() {
+      std::exception_ptr e = sync_and_take_error();
+      if (e) {
+        std::rethrow_exception(e);
+      }
+    }
+
+    // Same as sync(), but returns the exception (or a null pointer)
+    // instead of rethrowing it.
+    std::exception_ptr sync_and_take_error() {
+      wait();
+      std::exception_ptr e;
+      if (has_error.load(std::memory_order_acquire)) {
+        e = error;
+        error = std::exception_ptr();
+        has_error.store(false, std::memory_order_relaxed);
+        has_error_claim.store(false, std::memory_order_relaxed);
+      }
+      return e;
+    }
+
+    void record_error(std::exception_ptr e) {
+      bool expected = false;
+      if (has_error_claim.compare_exchange_strong(expected, true)) {
+        error = e;
+        has_error.store(true, std::memory_order_release);
+      }
+    }
+
+   private:
+    std::atomic<bool> has_error;
+    std::atomic<bool> has_error_claim;
+    std::exception_ptr error;
+
+    inline void wait();
+  };
+
+
+  class NativeScheduler {
+
+   public:
+    static NativeScheduler* instance() {
+      static NativeScheduler sched;
+      return &sched;
+    }
+
+    // Returns -1 if the calling thread is not a worker.
+    static int current_worker_id() {
+      NativeWorker* w = instance()->current_worker();
+      return (w != NULL) ? w->id : -1;
+    }
+
+    static int current_worker_count() {
+      return instance()->P;
+    }
+
+    NativeWorker* current_worker() {
+      return current_worker_slot();
+    }
+
+    void spawn(NativeTask* t) {
+      NativeWorker* w = current_worker();
+      if (w == NULL) {
+        run_task(t);
+        return;
+      }
+      w->deque.push(t);
+      if (num_sleeping.load(std::memory_order_relaxed) > 0) {
+        idle_cv.notify_one();
+      }
+    }
+
+    void spawn_to(NativeTask* t, int worker) {
+      NativeWorker* w = current_worker();
+      if ((w == NULL) || (worker < 0) || ((worker % P) == w->id)) {
+        spawn(t);
+        return;
+      }
+      NativeWorker* target = &workers[worker % P];
+      NativeTask* head = target->mailbox.load(std::memory_order_relaxed);
+      do {
+        t->next_mail = head;
+      } while (!target->mailbox.compare_exchange_weak(head, t,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed));
+      if (num_sleeping.load(std::memory_order_relaxed) > 0) {
+        idle_cv.notify_all();
+      }
+    }
+
+    // Execute tasks until group g has no pending tasks.
+    void wait_for(NativeTaskGroup* g) {
+      NativeWorker* w = current_worker();
+      assert(w != NULL);
+      int fail_count = 0;
+      while (g->pending.load(std::memory_order_acquire) > 0) {
+        NativeTask* t = find_work(w);
+        if (t != NULL) {
+          run_task(t);
+          fail_count = 0;
+        }
+        else {
+          fail_count++;
+          if (fail_count < NATIVE_SPIN_LIMIT) {
+            system_pause();
+          }
+          else {
+            std::this_thread::yield();
+          }
+        }
+      }
+    }
+
+   private:
+    int P;
+    NativeWorker* workers;
+    std::thread* threads;
+
+    std::atomic<bool> shutdown;
+    std::atomic<int> num_sleeping;
+    std::mutex idle_lock;
+    std::condition_variable idle_cv;
+
+    static NativeWorker*& current_worker_slot() {
+      static thread_local NativeWorker* w = NULL;
+      return w;
+    }
+
+    static int default_worker_count() {
+      int p = requested_worker_count();
+      if (p > 0) {
+        return p;
+      }
+      int hw = (int)std::thread::hardware_concurrency();
+      return (hw > 0) ? hw : 1;
+    }
+
+    NativeScheduler()
+      : P(default_worker_count()),
+        shutdown(false),
+        num_sleeping(0) {
+      workers = new NativeWorker[P];
+      for (int i = 0; i < P; i++) {
+        workers[i].id = i;
+        workers[i].rand_state = 2654435761u * (i + 1);
+      }
+
+      // The thread that creates the scheduler is worker 0.
+      current_worker_slot() = &workers[0];
+
+      threads = new std::thread[P];
+      for (int i = 1; i < P; i++) {
+        threads[i] = std::thread(&NativeScheduler::worker_loop, this, i);
+      }
+    }
+
+    ~NativeScheduler() {
+      shutdown.store(true);
+      {
+        std::lock_guard<std::mutex> guard(idle_lock);
+        idle_cv.notify_all();
+      }
+      for (int i = 1; i < P; i++) {
+        threads[i].join();
+      }
+      delete[] threads;
+      delete[] workers;
+    }
+
+    static void run_task(NativeTask* t) {
+      NativeTaskGroup* g = t->group;
+      try {
+        t->execute();
+      }
+      catch (...) {
+        g->record_error(std::current_exception());
+      }
+      delete t;
+      // The group may be destroyed as soon as its count drops, so
+      // this decrement must be the last access to it.
+      g->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    NativeTask* find_work(NativeWorker* w) {
+      NativeTask* t = w->deque.pop();
+      if (t == NULL) {
+        t = take_mail(w, w);
+      }
+      if (t == NULL) {
+        t = try_steal(w);
+      }
+      return t;
+    }
+
+    // Empties owner's mailbox into w's deque, and returns one of the
+    // tasks, or NULL if the mailbox was empty.
+    NativeTask* take_mail(NativeWorker* owner, NativeWorker* w) {
+      if (owner->mailbox.load(std::memory_order_relaxed) == NULL) {
+        return NULL;
+      }
+      NativeTask* t = owner->mailbox.exchange(NULL, std::memory_order_acquire);
+      if (t == NULL) {
+        return NULL;
+      }
+      // The mailbox is a stack; push all but the oldest task, which
+      // we run first.
+      while (t->next_mail != NULL) {
+        NativeTask* next = t->next_mail;
+        t->next_mail = NULL;
+        w->deque.push(t);
+        t = next;
+      }
+      return t;
+    }
+
+    NativeTask* try_steal(NativeWorker* thief) {
+      if (P <= 1) {
+        return NULL;
+      }
+      int victim_id = (int)(thief->next_rand() % (unsigned int)(P - 1));
+      if (victim_id >= thief->id) {
+        victim_id++;
+      }
+      NativeWorker* victim = &workers[victim_id];
+
+      NativeTask* t = victim->deque.steal();
+      if (t != NULL) {
+        // Batched steal: move up to half of what is left over to our
+        // own deque, where other thieves can find it.
+        long long extra = victim->deque.size_estimate() / 2;
+        if (extra > NATIVE_STEAL_BATCH - 1) {
+          extra = NATIVE_STEAL_BATCH - 1;
+        }
+        for (long long i = 0; i < extra; i++) {
+          NativeTask* x = victim->deque.steal();
+          if (x == NULL) {
+            break;
+          }
+          thief->deque.push(x);
+        }
+      }
+      else {
+        // Fall back to the tasks mailed to the victim.
+        t = take_mail(victim, thief);
+      }
+      return t;
+    }
+
+    void worker_loop(int id) {
+      NativeWorker* w = &workers[id];
+      current_worker_slot() = w;
+
+      int fail_count = 0;
+      while (!shutdown.load(std::memory_order_relaxed)) {
+        NativeTask* t = find_work(w);
+        if (t != NULL) {
+          run_task(t);
+          fail_count = 0;
+          continue;
+        }
+
+        fail_count++;
+        if (fail_count < NATIVE_SPIN_LIMIT) {
+          system_pause();
+        }
+        else if (fail_count < NATIVE_YIELD_LIMIT) {
+          std::this_thread::yield();
+        }
+        else {
+          // Sleep until a spawn wakes us up.  Spawns check
+          // num_sleeping without a fence, so a wakeup can be missed;
+          // the timeout bounds how long that can delay us.
+          std::unique_lock<std::mutex> lock(idle_lock);
+          num_sleeping.fetch_add(1);
+          if (!shutdown.load()) {
+            idle_cv.wait_for(lock, std::chrono::milliseconds(1));
+          }
+          num_sleeping.fetch_sub(1);
+          fail_count = NATIVE_SPIN_LIMIT;
+        }
+      }
+      current_worker_slot() = NULL;
+    }
+  };
+
+
+  template <class F>
+  void NativeTaskGroup::spawn(F&& f) {
+    typedef typename std::decay<F>::type FType;
+    NativeTask* t = new NativeFunctorTask<FType>(std::forward<F>(f));
+    t->group = this;
+    pending.fetch_add(1, std::memory_order_relaxed);
+    NativeScheduler::instance()->spawn(t);
+  }
+
+  template <class F>
+  void NativeTaskGroup::spawn_at(int worker, F&& f) {
+    typedef typename std::decay<F>::type FType;
+    NativeTask* t = new NativeFunctorTask<FType>(std::forward<F>(f));
+    t->group = this;
+    pending.fetch_add(1, std::memory_order_relaxed);
+    NativeScheduler::instance()->spawn_to(t, worker);
+  }
+
+  void NativeTaskGroup::wait() {
+    if (pending.load(std::memory_order_acquire) > 0) {
+      NativeScheduler::instance()->wait_for(this);
+    }
+  }
+
+};
+
+#endif // __NATIVE_SCHEDULER_H_
@@ -0,0 +1,159 @@
+/* omp_executor.h                         -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __OMP_EXECUTOR_H_
+#define __OMP_EXECUTOR_H_
+
+/**
+ * Executor which runs Nabbit tasks as OpenMP tasks.
+ *
+ * A spawn creates an "omp task", and a sync is an "omp taskwait".
+ * Note that taskwait waits for all the children of the current task,
+ * so a sync may also wait for tasks spawned from other groups in the
+ * same function frame.  That is conservative, but still correct.
+ *
+ * OpenMP only runs tasks in parallel inside a parallel region.
+ * execute() opens one (with one thread running the function, as in
+ * "omp single") unless the caller is already inside a parallel
+ * region, e.g., when a host application calls into Nabbit from its
+ * own OpenMP code.
+ *
+ * The number of threads is NABBIT_NWORKERS, if set, and otherwise the
+ * OpenMP default.
+ */
+
+#include <omp.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <new>
+
+#include "nabbit_executor.h"
+
+namespace nabbit {
+
+  class OpenMPExecutor : public Executor {
+   public:
+    OpenMPExecutor() {
+      P = requested_worker_count();
+      if (P <= 0) {
+        P = omp_get_max_threads();
+      }
+    }
+
+    const char* name() const { return "openmp"; }
+
+    int worker_id() {
+      return omp_get_thread_num();
+    }
+
+    int worker_count() {
+      return P;
+    }
+
+    void execute(const std::function<void()>& f) {
+      if (omp_in_parallel()) {
+        f();
+        return;
+      }
+
+      // Exceptions may not escape a parallel region.
+      std::exception_ptr e;
+#pragma omp parallel num_threads(P)
+      {
+#pragma omp single
+        {
+          try {
+            f();
+          }
+          catch (...) {
+            e = std::current_exception();
+          }
+        }
+      }
+      if (e) {
+        std::rethrow_exception(e);
+      }
+    }
+
+    void group_init(void* state) {
+      static_assert(sizeof(Group) <= sizeof(void*) * EXECUTOR_GROUP_STATE_WORDS,
+                    "OpenMPExecutor::Group does not fit in a TaskGroup");
+      new (state) Group();
+    }
+
+    void group_spawn(void* state, std::function<void()>&& f) {
+      Group* g = static_cast<Group*>(state);
+      std::function<void()>* fp = new std::function<void()>(std::move(f));
+#pragma omp task firstprivate(g, fp)
+      {
+        try {
+          (*fp)();
+        }
+        catch (...) {
+          g->record_error(std::current_exception());
+        }
+        delete fp;
+      }
+    }
+
+    std::exception_ptr group_wait(void* state) {
+      Group* g = static_cast<Group*>(state);
+#pragma omp taskwait
+      std::exception_ptr e = g->error;
+      g->~Group();
+      return e;
+    }
+
+   private:
+    int P;
+
+    // OpenMP tasks cannot throw, so each group keeps the first
+    // exception thrown by one of its tasks.
+    struct Group {
+      std::atomic<bool> has_error_claim;
+      std::exception_ptr error;
+
+      Group() : has_error_claim(false) { }
+
+      void record_error(std::exception_ptr e) {
+        bool expected = false;
+        if (has_error_claim.compare_exchange_strong(expected, true)) {
+          error = e;
+        }
+      }
+    };
+  };
+};
+
+#endif // __OMP_EXECUTOR_H_
@@ -0,0 +1,187 @@
+/* online_dag.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef __ONLINE_DAG_H_
+#define __ONLINE_DAG_H_
+
+/**
+ * An OnlineDAG is a static task graph of OnlineNabbitNodes that is
+ * built while it runs.
+ *
+ * Usage:
+ *
+ *   OnlineDAG<MyNode> dag;
+ *   nabbit::execute([&]() {
+ *       dag.run([&]() {
+ *           // For each new node n:
+ *           dag.add_node(n);
+ *           dag.add_edge(pred, n);   // For each predecessor of n.
+ *           dag.close_node(n);
+ *       });
+ *   });
+ *
+ * run() calls the producer function, and returns once the producer
+ * has returned and every node it closed has been computed.  A node
+ * runs as soon as it has been closed and all of its predecessors have
+ * been computed, while the producer keeps adding nodes.
+ *
+ * An edge (src, dst) can be added as long as dst has not been closed,
+ * whatever the state of src: if src has already been computed, the
+ * edge is simply not counted.  add_edge() takes O(1) time, and no
+ * lock: at worst, a CAS on src's successor list races with src
+ * sealing it.
+ *
+ * add_node(), add_edge() and close_node() must be called from the
+ * producer function itself, not from tasks that it spawns.  (With
+ * Cilk, close_node() waits for the node it enables, so there is less
+ * overlap.)  Every node should be closed before the producer returns;
+ * a node that is never closed never runs, nor do its descendants.
+ *
+ * The edges are stored in the OnlineDAG, which must stay alive for as
+ * long as its nodes run.  An OnlineDAG runs once.
+ */
+
+#include <assert.h>
+#include <deque>
+#include <functional>
+
+#include "nabbit_sysdep.h"
+#include "online_nabbit_node.h"
+
+template <class NodeType>
+class OnlineDAG {
+
+ public:
+  OnlineDAG();
+
+  template <class F>
+  void run(const F& producer);
+
+  // Adds a node, open for new edges into it.
+  void add_node(NodeType* node);
+
+  // Adds an edge: dst depends on src.  dst must still be open.
+  void add_edge(NodeType* src, NodeType* dst);
+
+  // Declares that no more edges will be added into node, so it can
+  // run once its predecessors are done.
+  void close_node(NodeType* node);
+
+  long long num_nodes();
+  long long num_edges();
+
+ private:
+  // A deque never moves its elements, so the links stay put.
+  std::deque<OnlineNabbitSuccLink> links;
+  long long V;
+  long long E;
+  long long num_closed;
+
+  // Spawns a ready node into run()'s spawn scope.
+  std::function<void(NodeType*)> launch;
+};
+
+
+template <class NodeType>
+OnlineDAG<NodeType>::OnlineDAG()
+  : V(0),
+    E(0),
+    num_closed(0) {
+}
+
+
+template <class NodeType>
+template <class F>
+void OnlineDAG<NodeType>::run(const F& producer) {
+  assert(!this->launch);
+  NABBIT_SPAWN_SCOPE;
+  this->launch = [&](NodeType* n) {
+    NABBIT_SPAWN(n->compute_and_notify());
+  };
+  producer();
+  assert(this->num_closed == this->V);
+  NABBIT_SYNC;
+  this->launch = nullptr;
+}
+
+
+template <class NodeType>
+void OnlineDAG<NodeType>::add_node(NodeType* node) {
+  assert(node->join_counter == 1);
+  assert(!node->closed);
+  this->V++;
+}
+
+
+template <class NodeType>
+void OnlineDAG<NodeType>::add_edge(NodeType* src, NodeType* dst) {
+  assert(!dst->closed);
+
+  // dst is still open, so its counter cannot reach 0 here, even if
+  // src finishes and counts itself before we find the list sealed.
+  nabbit::atomic_add_and_fetch(&dst->join_counter, 1);
+  OnlineNabbitSuccLink link = { dst, NULL };
+  this->links.push_back(link);
+  if (!src->succ_list.try_add(&this->links.back())) {
+    // src has already been computed.
+    this->links.pop_back();
+    nabbit::atomic_sub_and_fetch(&dst->join_counter, 1);
+  }
+  this->E++;
+}
+
+
+template <class NodeType>
+void OnlineDAG<NodeType>::close_node(NodeType* node) {
+  assert(this->launch);
+  assert(!node->closed);
+  node->closed = true;
+  this->num_closed++;
+  if (nabbit::atomic_sub_and_fetch(&node->join_counter, 1) == 0) {
+    this->launch(node);
+  }
+}
+
+
+template <class NodeType>
+long long OnlineDAG<NodeType>::num_nodes() {
+  return this->V;
+}
+
+template <class NodeType>
+long long OnlineDAG<NodeType>::num_edges() {
+  return this->E;
+}
+
+#endif // __ONLINE_DAG_H_
@@ -0,0 +1,136 @@
+/* online_nabbit_node.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef __ONLINE_NABBIT_NODE_H_
+#define __ONLINE_NABBIT_NODE_H_
+
+/**
+ * A node for a static task graph that can grow while it runs.  See
+ * OnlineDAG, which adds the nodes and edges.
+ *
+ * Like a StaticNabbitNode, an OnlineNabbitNode counts its unfinished
+ * predecessors with a join counter, and there is no hash table.  Like
+ * a DynamicNabbitNode, each node keeps its successors in a lock-free
+ * list, which it seals once it has been computed, so an edge can be
+ * added from a predecessor that is running or already done.
+ */
+
+#include <assert.h>
+
+#include "nabbit_sysdep.h"
+#include "sealed_succ_list.h"
+
+class OnlineNabbitNode;
+template <class NodeType> class OnlineDAG;
+
+// An entry in a node's list of successors to notify.  The links are
+// owned by the OnlineDAG.
+struct OnlineNabbitSuccLink {
+  OnlineNabbitNode* node;
+  OnlineNabbitSuccLink* next;
+};
+
+
+class OnlineNabbitNode {
+
+ public:
+  long long key;
+
+  OnlineNabbitNode(long long k);
+
+  // True once Compute() has returned.
+  inline bool is_computed();
+
+ protected:
+  virtual void Compute() = 0;
+
+ private:
+  template <class NodeType> friend class OnlineDAG;
+
+  // Unfinished predecessors, plus one while the node is still open
+  // for new edges.
+  volatile long join_counter;
+  volatile int computed;
+  bool closed;
+
+  // Successors waiting for this node, sealed once the node has been
+  // computed.
+  SealedSuccList<OnlineNabbitSuccLink> succ_list;
+
+  void compute_and_notify();
+  void notify_links(OnlineNabbitSuccLink* link, int count);
+};
+
+
+OnlineNabbitNode::OnlineNabbitNode(long long k)
+  : key(k),
+    join_counter(1),
+    computed(0),
+    closed(false) {
+}
+
+bool OnlineNabbitNode::is_computed() {
+  return this->computed != 0;
+}
+
+
+void OnlineNabbitNode::compute_and_notify() {
+  this->Compute();
+  this->computed = 1;
+
+  OnlineNabbitNode* node = this;
+  SealedSuccList<OnlineNabbitSuccLink>::notify_chunks(
+      this->succ_list.seal(),
+      [node](OnlineNabbitSuccLink* chunk, int count) {
+        node->notify_links(chunk, count);
+      });
+}
+
+
+// Notifies the count successors in the list starting at link.
+void OnlineNabbitNode::notify_links(OnlineNabbitSuccLink* link, int count) {
+  NABBIT_SPAWN_SCOPE;
+  for (int i = 0; i < count; i++) {
+    OnlineNabbitNode* current_succ = link->node;
+    link = link->next;
+
+    assert(current_succ->join_counter > 0);
+    if (nabbit::atomic_sub_and_fetch(&current_succ->join_counter, 1) == 0) {
+      NABBIT_SPAWN(current_succ->compute_and_notify());
+    }
+  }
+  NABBIT_SYNC;
+}
+
+#endif // __ONLINE_NABBIT_NODE_H_
@@ -0,0 +1,243 @@
+/* output_slot.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#ifndef __OUTPUT_SLOT_H_
+#define __OUTPUT_SLOT_H_
+
+/**
+ * Reference-counted output buffers for static Nabbit nodes.
+ *
+ * A StaticOutputSlot<T> holds the output of one node, in a buffer
+ * taken from an OutputPool<T>.  The node fills the buffer in its
+ * Compute(), and each successor reads it in its own Compute().  When
+ * a successor's Compute() returns, the engine counts it as done with
+ * the slot, and the last one returns the buffer to the pool.  The
+ * buffers in use then track the frontier of the computation instead
+ * of the whole DAG.
+ *
+ * A sink has no successors to release its slot, so it keeps its
+ * buffer until release() is called, the slot is allocated again, or
+ * the slot is destroyed.  So does a node whose successors are not
+ * all computed, e.g., by StaticDAG::sink_compute().  A released
+ * buffer is gone: StaticDAG::recompute() must also recompute every
+ * node whose output it reads.
+ *
+ * Buffers from the pool are reused as is; the producer is expected
+ * to overwrite them.
+ */
+
+#include <assert.h>
+#include <vector>
+
+#include "nabbit_sysdep.h"
+
+
+// A thread-safe free list of buffers of type T.  The pool owns its
+// free buffers, and must outlive the slots that use it.
+template <class T>
+class OutputPool {
+
+ public:
+  OutputPool();
+  ~OutputPool();
+
+  // Returns a free buffer, or a new T if there is none.
+  T* acquire();
+  void release(T* buf);
+
+  // The number of buffers handed out and not yet returned, the
+  // largest that number has been, and the number of T's created.
+  long get_live() { return this->live; }
+  long get_peak() { return this->peak; }
+  long get_allocated() { return this->allocated; }
+
+ private:
+  int lock;
+  std::vector<T*> free_list;
+  long live;
+  long peak;
+  long allocated;
+};
+
+
+template <class T>
+OutputPool<T>::OutputPool()
+  : lock(0),
+    live(0),
+    peak(0),
+    allocated(0) {
+}
+
+template <class T>
+OutputPool<T>::~OutputPool() {
+  for (size_t i = 0; i < this->free_list.size(); i++) {
+    delete this->free_list[i];
+  }
+}
+
+template <class T>
+T* OutputPool<T>::acquire() {
+  T* buf = NULL;
+  nabbit::lock_acquire(&this->lock);
+  if (!this->free_list.empty()) {
+    buf = this->free_list.back();
+    this->free_list.pop_back();
+  }
+  else {
+    this->allocated++;
+  }
+  this->live++;
+  if (this->live > this->peak) {
+    this->peak = this->live;
+  }
+  nabbit::lock_release(&this->lock);
+
+  if (buf == NULL) {
+    buf = new T();
+  }
+  return buf;
+}
+
+template <class T>
+void OutputPool<T>::release(T* buf) {
+  nabbit::lock_acquire(&this->lock);
+  this->free_list.push_back(buf);
+  this->live--;
+  assert(this->live >= 0);
+  nabbit::lock_release(&this->lock);
+}
+
+
+
+// The part of a slot that the engine sees.
+class StaticOutputSlotBase {
+ public:
+  virtual ~StaticOutputSlotBase() { }
+
+  // Called once by each successor of the owner, after its Compute().
+  virtual void consumer_done() = 0;
+};
+
+
+template <class T>
+class StaticOutputSlot : public StaticOutputSlotBase {
+
+ public:
+  StaticOutputSlot();
+  ~StaticOutputSlot();
+
+  // Makes this the output slot of owner, with buffers from pool.
+  // Call once owner's edges are final: the slot waits for as many
+  // consumers as owner has successors at this point.
+  template <class NodeType>
+  void attach(NodeType* owner, OutputPool<T>* pool);
+
+  // Takes a buffer from the pool, for the owner to fill in its
+  // Compute().  Returns any buffer the slot still held first.
+  T* allocate();
+
+  // The buffer, for the owner's successors to read.
+  T* get() {
+    assert(this->buffer != NULL);
+    return this->buffer;
+  }
+  bool has_buffer() { return this->buffer != NULL; }
+
+  // Returns the buffer to the pool now, if the slot holds one.
+  void release();
+
+  void consumer_done();
+
+ private:
+  OutputPool<T>* pool;
+  T* buffer;
+  int num_consumers;
+  volatile long remaining;
+};
+
+
+template <class T>
+StaticOutputSlot<T>::StaticOutputSlot()
+  : pool(NULL),
+    buffer(NULL),
+    num_consumers(0),
+    remaining(0) {
+}
+
+template <class T>
+StaticOutputSlot<T>::~StaticOutputSlot() {
+  this->release();
+}
+
+template <class T>
+template <class NodeType>
+void StaticOutputSlot<T>::attach(NodeType* owner, OutputPool<T>* pool_) {
+  assert(pool_ != NULL);
+  this->release();
+  this->pool = pool_;
+  this->num_consumers = owner->num_successors();
+  owner->set_output_slot(this);
+}
+
+template <class T>
+T* StaticOutputSlot<T>::allocate() {
+  assert(this->pool != NULL);
+  this->release();
+  this->buffer = this->pool->acquire();
+  this->remaining = this->num_consumers;
+  return this->buffer;
+}
+
+template <class T>
+void StaticOutputSlot<T>::release() {
+  if (this->buffer != NULL) {
+    this->pool->release(this->buffer);
+    this->buffer = NULL;
+  }
+}
+
+template <class T>
+void StaticOutputSlot<T>::consumer_done() {
+  // Nothing to count if the owner was cancelled before it allocated.
+  if (this->buffer == NULL) {
+    return;
+  }
+  assert(this->remaining > 0);
+  if (nabbit::atomic_sub_and_fetch(&this->remaining, 1) == 0) {
+    this->release();
+  }
+}
+
+#endif // __OUTPUT_SLOT_H_
@@ -0,0 +1,122 @@
+/* sealed_succ_list.h                    -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef __SEALED_SUCC_LIST_H_
+#define __SEALED_SUCC_LIST_H_
+
+/**
+ * A lock-free list of successors to notify, which its node seals
+ * once it has been computed.  Used by DynamicNabbitNode and
+ * OnlineNabbitNode, whose successors may register while the node
+ * is running or after it is done.
+ *
+ * Link is a struct with a "next" pointer to another Link, plus
+ * whatever the node needs to notify the successor.  Links are owned
+ * by the registrants, so registering does not allocate.  A
+ * registrant that finds the list sealed counts the node as finished
+ * itself.
+ */
+
+#include <assert.h>
+#include <atomic>
+
+#include "nabbit_sysdep.h"
+
+template <class Link>
+class SealedSuccList {
+ public:
+  SealedSuccList()
+    : head(NULL) { }
+
+  // Pushes link onto the list.  Returns false, without adding it, if
+  // the list has been sealed.  A caller that finds the list sealed
+  // goes on to read the node's results, so the loads that see the
+  // seal acquire the exchange in seal().
+  bool try_add(Link* link) {
+    Link* h = this->head.load(std::memory_order_acquire);
+    do {
+      if (h == sealed()) {
+        return false;
+      }
+      link->next = h;
+    } while (!this->head.compare_exchange_weak(h, link,
+                                               std::memory_order_release,
+                                               std::memory_order_acquire));
+    return true;
+  }
+
+  // Closes the list, and returns everything in it.  Nothing can be
+  // added once the list is sealed, so one pass over the result
+  // notifies every successor.
+  Link* seal() {
+    Link* h = this->head.exchange(sealed(), std::memory_order_acq_rel);
+    assert(h != sealed());
+    return h;
+  }
+
+  // Calls notify(chunk, count) on consecutive pieces of the list
+  // starting at link.  Long lists are cut into chunks of
+  // parallel_notify_threshold() links, and all but the last chunk
+  // are notified in spawned tasks.
+  template <class F>
+  static void notify_chunks(Link* link, const F& notify) {
+    NABBIT_SPAWN_SCOPE;
+    int grain = nabbit::parallel_notify_threshold();
+    while (link != NULL) {
+      Link* chunk = link;
+      int count = 0;
+      while ((link != NULL) && (count < grain)) {
+        link = link->next;
+        count++;
+      }
+      if (link != NULL) {
+        NABBIT_SPAWN(notify(chunk, count));
+      }
+      else {
+        notify(chunk, count);
+      }
+    }
+    NABBIT_SYNC;
+  }
+
+ private:
+  std::atomic<Link*> head;
+
+  static Link* sealed() {
+    static Link sealed_link;
+    return &sealed_link;
+  }
+};
+
+#endif // __SEALED_SUCC_LIST_H_
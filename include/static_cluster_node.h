@@ -0,0 +1,80 @@
+/* static_cluster_node.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#ifndef __STATIC_CLUSTER_NODE_H_
+#define __STATIC_CLUSTER_NODE_H_
+
+/**
+ * A node of a coarsened StaticDAG, which stands for a group of nodes
+ * of the original DAG.  See StaticDAG::coarsen().
+ *
+ * Computing a cluster computes its members one after another, in the
+ * topological order they were added in, without touching their join
+ * counters or spawning anything: the edges between members are
+ * satisfied by that order, and the edges into the cluster by the
+ * cluster's own join counter.
+ */
+
+#include <assert.h>
+#include <vector>
+
+#include "static_nabbit_node.h"
+
+class StaticClusterNode final : public StaticNabbitNode {
+
+ public:
+  StaticClusterNode(long long k) : StaticNabbitNode(k) { }
+
+  // Members must be added in a topological order.
+  void add_member(StaticNabbitNode* node) { this->members.push_back(node); }
+  int num_members() { return (int)this->members.size(); }
+  StaticNabbitNode* member(int i) { return this->members[i]; }
+
+ protected:
+  void InitNode() { }
+  void Compute();
+
+ private:
+  std::vector<StaticNabbitNode*> members;
+};
+
+
+void StaticClusterNode::Compute() {
+  for (size_t i = 0; i < this->members.size(); i++) {
+    this->members[i]->compute_in_order();
+  }
+}
+
+#endif // __STATIC_CLUSTER_NODE_H_
@@ -0,0 +1,1211 @@
+/* static_dag.h                           -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __STATIC_DAG_H_
+#define __STATIC_DAG_H_
+
+/**
+ * A StaticDAG owns the edges of a static task graph, built from
+ * StaticNabbitNode or StaticSerialNode nodes.
+ *
+ * Usage:
+ *
+ *   1. Create and initialize the nodes, and add edges with add_dep(),
+ *      as usual.
+ *   2. Register every node with add_node().
+ *   3. Call freeze().
+ *
+ * freeze() compacts the predecessor and successor lists of all the
+ * registered nodes into contiguous CSR (compressed sparse row)
+ * arrays, and frees the per-node DynamicArrays.  Afterwards, each
+ * node's edges are a slice of these arrays, so notifying successors
+ * is a linear scan, without the bounds checks and waits of
+ * DynamicArray::get().  Frozen StaticNabbitNodes with very many
+ * predecessors also switch to a CombiningJoinCounter, so that their
+ * predecessors do not all decrement the same counter.
+ *
+ * Once frozen, no edges can be added.  The StaticDAG must stay alive
+ * for as long as its nodes are in use.
+ *
+ * The DAG also holds the optional state of its StaticNabbitNodes
+ * (priorities, cancellation tokens, memory budgets, and so on) in
+ * side tables indexed by each node's position, so that a node that
+ * uses none of it stays small.  See StaticNodeTables.
+ *
+ * Registered nodes (frozen or not) can be executed more than once, by
+ * calling reset() between runs.
+ *
+ * execute_all() runs the DAG from all of its sources, i.e., the nodes
+ * with no predecessors, so the caller does not have to pick a source
+ * node or add a dummy root to a DAG with several sources.
+ *
+ * For StaticNabbitNode DAGs, compute_priorities() computes the bottom
+ * level of each node and sorts successors by it, so that with
+ * NOTIFY_PRIORITY, nodes on the critical path are run first.
+ *
+ * Also for StaticNabbitNode DAGs, sink_compute() evaluates only the
+ * given sinks and their ancestors, instead of everything reachable
+ * from a source, and recompute() reevaluates only the nodes that
+ * depend on the given dirty nodes.
+ *
+ * A StaticNabbitNode DAG whose nodes do very little work each can be
+ * coarsened with coarsen(), which groups chains and other small
+ * convex subgraphs into StaticClusterNodes, up to a given cost.
+ * execute_all() then runs the DAG of clusters, and each cluster runs
+ * its members serially, without spawns or atomic operations between
+ * them.
+ *
+ * choose_traversal() looks at the size, total cost and width of a
+ * StaticNabbitNode DAG, and decides whether execute_adaptive() should
+ * run it serially or in parallel.  In parallel, nodes with little
+ * work below them run inline, on the worker that enabled them.
+ *
+ * compute_levels() sorts a StaticNabbitNode DAG into topological
+ * levels, and execute_levels() then runs one level at a time, each
+ * with a parallel loop, like sw_compute_pure_wavefront() does for the
+ * Smith-Waterman blocks.  No join counters are touched while running;
+ * the end of each loop is the only synchronization.
+ *
+ * execute_and_record() runs a StaticNabbitNode DAG like execute_all(),
+ * and records which worker computed each node, and in what order.
+ * Later runs of execute_replay() give each worker its recorded nodes
+ * in the same order, without spawning them.  A worker whose next node
+ * is not ready yet takes the next node of a worker that has fallen
+ * behind instead.
+ */
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "nabbit_sysdep.h"
+#include "static_cluster_node.h"
+#include "static_nabbit_node.h"
+#include "static_node_tables.h"
+
+template <class NodeType>
+class StaticDAG {
+
+ public:
+  StaticDAG();
+  ~StaticDAG();
+
+  // Registers a node.  All nodes must be registered before freeze().
+  void add_node(NodeType* node);
+
+  void freeze();
+  bool is_frozen();
+
+  // Resets the join counters of all nodes to their in-degrees, so the
+  // DAG can be executed again after source_compute() returns.  Takes
+  // O(V) work, in parallel, and does not allocate.  User data in the
+  // nodes is left alone.
+  void reset();
+
+  // Computes every registered node, starting from all the nodes with
+  // in-degree 0.  A StaticNabbitNode DAG launches its sources in
+  // parallel.  A frozen DAG finds its sources once, in freeze() or
+  // StaticDAGBuilder::build(); otherwise they are found on each call,
+  // in O(V) work.  A coarsened DAG runs its clusters instead.
+  void execute_all();
+
+  // Runs the DAG nested in parent, a StaticNabbitNode that calls this
+  // from its Compute().  The DAG starts when Compute() returns, on the
+  // same workers, and parent's successors are notified only after
+  // every sink of the DAG has been computed.  No worker waits for it:
+  // whichever worker computes the last sink goes on to notify them.
+  // The DAG must be reset, and must not be changed or run otherwise
+  // until parent completes.  A parent computed in a cluster, or by a
+  // serial execute_adaptive(), runs the DAG before it returns instead.
+  // StaticNabbitNode only.
+  void execute_nested(StaticNabbitNode* parent);
+
+  // The number of nodes with in-degree 0.
+  long long num_sources();
+
+  // Sets the notify policy of every node (StaticNabbitNode only).
+  void set_notify_policy(StaticNotifyPolicy policy);
+
+  // Sets the cancellation token of every node (StaticNabbitNode
+  // only).  See CancellationToken.
+  void set_cancellation_token(CancellationToken* token);
+
+  // Sets the memory budget of every node (StaticNabbitNode only).
+  // See MemoryBudget.
+  void set_memory_budget(MemoryBudget* budget);
+
+  // Sets the priority of every node to its bottom level: the total
+  // cost of the most expensive path from the node to a sink.  costs[i]
+  // is the cost of the i-th registered node, or every node costs 1 if
+  // costs is NULL.  Then sorts each node's successors by decreasing
+  // priority, and sets every node to NOTIFY_PRIORITY.
+  //
+  // The DAG must be frozen, and must not be running.  Takes O(V + E)
+  // work.  StaticNabbitNode only.
+  void compute_priorities(const long long* costs);
+
+  // Computes the given sinks, and only the nodes they depend on.
+  // Marks the ancestors of the sinks in parallel, resets their join
+  // counters, and runs from every source among them.  Nodes outside
+  // that subgraph are not computed, and their join counters are not
+  // touched.  Returns after all the sinks have been computed, with the
+  // subgraph reset again, so the DAG can be run again without a
+  // reset().
+  //
+  // Takes work proportional to the size of the subgraph (nodes and
+  // edges), plus the edges out of it.  The DAG need not be frozen,
+  // but must not be running.  StaticNabbitNode only.
+  void sink_compute(NodeType* sink);
+  void sink_compute(NodeType* const* sinks, int num_sinks);
+
+  // Recomputes the given dirty nodes, and every node that depends on
+  // them, after the DAG has already been run once.  Marks the
+  // descendants of the dirty nodes in parallel, and sets each one's
+  // join counter to count only its marked predecessors.  Clean
+  // predecessors are counted as done up front (and folded in, for a
+  // StaticReductionNode), so their results from the earlier run are
+  // reused.  Returns with the recomputed nodes reset again.
+  //
+  // Takes work proportional to the number of recomputed nodes and the
+  // edges into them.  Same restrictions as sink_compute().
+  void recompute(NodeType* dirty);
+  void recompute(NodeType* const* dirty, int num_dirty);
+
+  // Groups the nodes into clusters of total cost at most grain (or a
+  // single node, if it costs more), for execute_all() to run.  costs[i]
+  // is the cost of the i-th registered node, or every node costs 1 if
+  // costs is NULL.  Visits the nodes in a depth-first topological
+  // order, and adds each one to the latest cluster among those of its
+  // predecessors, if it fits, or else to a new cluster.  Every edge
+  // then leads to the same or a later cluster, so the clusters are
+  // convex, and form a DAG.  Chains become runs of a single cluster,
+  // and grids become strips of a row.
+  //
+  // Each cluster takes the notify policy, cancellation token, memory
+  // budget and affinity of its first member, and the largest memory
+  // estimate of its members; later calls to the setters above also
+  // apply to the clusters.  Members fold their predecessors (see
+  // StaticReductionNode) just before they are computed, and release
+  // their inputs (see StaticOutputSlot) as usual.  source_compute(),
+  // sink_compute() and recompute() still run node by node.
+  //
+  // The DAG must be frozen, and must not be running.  Takes
+  // O(V + E) work.  StaticNabbitNode only.
+  void coarsen(const long long* costs, long long grain);
+
+  // Drops the clusters, so that execute_all() runs node by node again.
+  void uncoarsen();
+
+  // The number of clusters, or 0 if the DAG is not coarsened.
+  long long num_clusters();
+
+  // Chooses how execute_adaptive() runs the DAG, and returns the
+  // choice.  costs[i] is the cost of the i-th registered node, or
+  // every node costs 1 if costs is NULL.  The width is the largest
+  // number of nodes at the same depth.  The DAG runs serially
+  // (SERIAL_STATIC_TRAVERSAL) if its total cost is at most
+  // serial_work, or its width is 1; otherwise it runs in parallel
+  // (STATIC_NABBIT_TRAVERSAL).
+  //
+  // Also estimates, for each node, the total cost of the nodes
+  // reachable from it, counting shared descendants once per path.
+  // In a parallel run, an enabled node whose estimate is below
+  // inline_work is not spawned, but runs after the node that enabled
+  // it, on the same worker, until the estimates of the nodes a
+  // worker has run that way add up to inline_work.  Pass 0 to spawn
+  // every node.  Inline nodes ignore their affinity.
+  //
+  // The DAG must be frozen, and must not be running.  Takes O(V + E)
+  // work.  StaticNabbitNode only.
+  DAGTraversalType choose_traversal(const long long* costs,
+                                    long long serial_work,
+                                    long long inline_work);
+
+  // Runs every node as chosen by choose_traversal(), which must have
+  // been called.  A serial run computes the nodes in a topological
+  // order, on the calling worker, without spawns or atomic
+  // operations, and is also used when there is only one worker.
+  // Otherwise, same as execute_all().
+  void execute_adaptive();
+  DAGTraversalType get_traversal();
+
+  // Groups the nodes by depth: a node's level is the length of the
+  // longest path to it from a source.  The levels are found in
+  // parallel, one level at a time, borrowing the join counters.
+  //
+  // The DAG must be frozen, and must not be running.  Takes O(V + E)
+  // work.  StaticNabbitNode only.
+  void compute_levels();
+
+  // Runs the levels found by compute_levels() in order, computing the
+  // nodes of each level in a parallel loop, and starting a level only
+  // when the one before it is done.  Nodes fold their predecessors
+  // (see StaticReductionNode), release their inputs (see
+  // StaticOutputSlot) and run nested DAGs as in a cluster; their
+  // notify policies, affinities and memory budgets are ignored.  The
+  // clusters of a coarsened DAG are ignored too.  Call reset() between
+  // runs, as for execute_all().
+  void execute_levels();
+
+  // The number of levels, or 0 before compute_levels().
+  long long num_levels();
+
+  // Same as execute_all(), but also records the worker that computes
+  // each node, and the order in which nodes start, for
+  // execute_replay().  Replaces any earlier recording.  If the run is
+  // cancelled, or throws, nothing is recorded.  Nodes computed by a
+  // thread that is not a worker are recorded for worker 0.
+  //
+  // The DAG must be frozen, not coarsened, and reset.  Takes O(V log V)
+  // work after the run.  StaticNabbitNode only.
+  void execute_and_record();
+
+  // Runs the DAG with the schedule from execute_and_record(): one task
+  // per recorded worker, which computes that worker's nodes in their
+  // recorded order, waiting only for each node's predecessors to
+  // finish.  A task whose next node is not ready yet computes, if it
+  // can, the next ready node of another task instead (a steal), and
+  // once its own nodes are done, it keeps helping the other tasks.
+  // Nodes are computed as in a cluster; see execute_levels().  Call
+  // reset() between runs, as for execute_all().
+  void execute_replay();
+
+  // Whether execute_and_record() has recorded a schedule.
+  bool has_schedule();
+
+  // The number of nodes the last execute_replay() stole from another
+  // task.
+  long long num_replay_steals();
+
+  long long num_nodes();
+  long long num_edges();
+  NodeType* get_node(long long i);
+
+ private:
+  template <class T> friend class StaticDAGBuilder;
+
+  std::vector<NodeType*> nodes;
+  // The nodes with in-degree 0, and with out-degree 0, once frozen.
+  std::vector<NodeType*> sources;
+  std::vector<NodeType*> sinks;
+  void find_sources();
+  bool frozen;
+  long long E;
+
+  // The optional state of the nodes, by dag_index.
+  StaticNodeTables tables;
+  void prepare_combining_joins(const long long* pred_offsets);
+
+  // The indices of the nodes in a depth-first topological order: a
+  // node's first successor tends to come right after it.  The DAG
+  // must be frozen.  Takes O(V + E) work.
+  std::vector<long long> topological_order();
+
+  // Edges into node i are pred_edges[pred_offsets[i] ..
+  // pred_offsets[i+1]-1], and similarly for edges out of node i.
+  long long* pred_offsets;
+  long long* succ_offsets;
+  NodeType** pred_edges;
+  NodeType** succ_edges;
+
+  // The nodes marked by the current sink_compute() or recompute().
+  std::vector<NodeType*> cone;
+  int cone_lock;
+  void mark_cone(std::vector<NodeType*> work, bool ancestors);
+  void mark_all(NodeType* const* start, int num_start, bool ancestors);
+  void clear_cone();
+
+  // The DAG of clusters, set by coarsen().
+  StaticDAG<StaticNabbitNode>* coarse;
+
+  // Set by choose_traversal().
+  DAGTraversalType traversal;
+  std::vector<NodeType*> serial_order;
+
+  // Set by compute_levels(): level k is level_nodes[level_offsets[k]
+  // .. level_offsets[k+1]-1].
+  std::vector<NodeType*> level_nodes;
+  std::vector<long long> level_offsets;
+
+  // Set by execute_and_record(): the nodes of task q are
+  // replay_nodes[replay_offsets[q] .. replay_offsets[q+1]-1].  While
+  // execute_replay() runs, every node of task q before
+  // replay_heads[q] has been claimed.
+  std::vector<NodeType*> replay_nodes;
+  std::vector<long long> replay_offsets;
+  std::vector<long> replay_heads;
+  volatile long replay_steals;
+  volatile int replay_aborted;
+  long replay_head(long q);
+  bool replay_run(NodeType* n);
+  void replay_task(long q);
+};
+
+
+template <class NodeType>
+StaticDAG<NodeType>::StaticDAG()
+  : frozen(false),
+    E(0),
+    pred_offsets(NULL),
+    succ_offsets(NULL),
+    pred_edges(NULL),
+    succ_edges(NULL),
+    cone_lock(0),
+    coarse(NULL),
+    traversal(STATIC_NABBIT_TRAVERSAL),
+    replay_steals(0),
+    replay_aborted(0) {
+}
+
+template <class NodeType>
+StaticDAG<NodeType>::~StaticDAG() {
+  this->uncoarsen();
+  delete[] pred_offsets;
+  delete[] succ_offsets;
+  delete[] pred_edges;
+  delete[] succ_edges;
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::add_node(NodeType* node) {
+  assert(!this->frozen);
+  assert(node->predecessors != NULL);
+  long long index = (long long)this->nodes.size();
+  this->nodes.push_back(node);
+  this->tables.resize(index + 1);
+  node->join_tables(&this->tables, index);
+}
+
+
+// Called before the nodes are frozen in parallel, once the in-degrees
+// are known.
+template <class NodeType>
+void StaticDAG<NodeType>::prepare_combining_joins(const long long* pred_offsets) {
+  long long V = (long long)this->nodes.size();
+  long long threshold = nabbit::combining_join_threshold();
+  for (long long i = 0; i < V; i++) {
+    if (pred_offsets[i+1] - pred_offsets[i] > threshold) {
+      this->tables.combining_join.use();
+      return;
+    }
+  }
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::freeze() {
+  assert(!this->frozen);
+  long long V = (long long)this->nodes.size();
+
+  // Prefix sums of the degrees give the start of each node's slice.
+  this->pred_offsets = new long long[V+1];
+  this->succ_offsets = new long long[V+1];
+  this->pred_offsets[0] = 0;
+  this->succ_offsets[0] = 0;
+  for (long long i = 0; i < V; i++) {
+    NodeType* n = this->nodes[i];
+    this->pred_offsets[i+1] = this->pred_offsets[i] + n->predecessors->size_estimate();
+    this->succ_offsets[i+1] = this->succ_offsets[i] + n->successors->size_estimate();
+  }
+
+  // Every edge is counted once at each end, unless some endpoint was
+  // not registered.
+  this->E = this->pred_offsets[V];
+  assert(this->succ_offsets[V] == this->E);
+  this->pred_edges = new NodeType*[this->E];
+  this->succ_edges = new NodeType*[this->E];
+  this->prepare_combining_joins(this->pred_offsets);
+
+  // Copy each node's edges into its slice.
+  nabbit::parallel_for(0, V, [this](long i) {
+      NodeType* n = this->nodes[i];
+
+      int np = n->predecessors->size_estimate();
+      NodeType** preds = this->pred_edges + this->pred_offsets[i];
+      for (int j = 0; j < np; j++) {
+        preds[j] = n->predecessors->get(j);
+      }
+
+      int ns = n->successors->size_estimate();
+      NodeType** succs = this->succ_edges + this->succ_offsets[i];
+      for (int j = 0; j < ns; j++) {
+        succs[j] = n->successors->get(j);
+      }
+
+      delete n->predecessors;
+      delete n->successors;
+      n->predecessors = NULL;
+      n->successors = NULL;
+
+      n->num_frozen_preds = np;
+      n->num_frozen_succs = ns;
+      n->frozen_preds = preds;
+      n->frozen_succs = succs;
+      n->frozen = true;
+      assert(n->dag_index == i);
+      n->setup_frozen_join();
+    });
+
+  this->frozen = true;
+  this->find_sources();
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::find_sources() {
+  this->sources.clear();
+  this->sinks.clear();
+  for (size_t i = 0; i < this->nodes.size(); i++) {
+    if (this->nodes[i]->num_predecessors() == 0) {
+      this->sources.push_back(this->nodes[i]);
+    }
+    if (this->nodes[i]->num_successors() == 0) {
+      this->sinks.push_back(this->nodes[i]);
+    }
+  }
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::execute_all() {
+  if (this->coarse != NULL) {
+    this->coarse->execute_all();
+    return;
+  }
+  if (!this->frozen) {
+    this->find_sources();
+  }
+  NodeType::compute_sources(this->sources.data(),
+                            (long)this->sources.size());
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::execute_nested(StaticNabbitNode* parent) {
+  if (this->coarse != NULL) {
+    this->coarse->execute_nested(parent);
+    return;
+  }
+  if (!this->frozen) {
+    this->find_sources();
+  }
+  if (this->sinks.empty()) {
+    return;
+  }
+  // One nested DAG per Compute().
+  StaticNestedRun* run =
+    parent->own_tables()->use_nested_run(parent->table_row());
+  assert(run->sources == NULL);
+  assert(this->tables.nested_parent == NULL);
+  this->tables.nested_pending = (long)this->sinks.size();
+  this->tables.nested_parent = parent;
+  run->inner = &this->tables;
+  run->num_sources = (long)this->sources.size();
+  run->sources = this->sources.data();
+}
+
+template <class NodeType>
+long long StaticDAG<NodeType>::num_sources() {
+  if (!this->frozen) {
+    this->find_sources();
+  }
+  return (long long)this->sources.size();
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::reset() {
+  NodeType** node_list = this->nodes.data();
+  nabbit::parallel_for(0, (long)this->nodes.size(), [=](long i) {
+      node_list[i]->reset_node();
+    });
+  this->tables.reset_nested();
+  if (this->coarse != NULL) {
+    this->coarse->reset();
+  }
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::set_notify_policy(StaticNotifyPolicy policy) {
+  for (size_t i = 0; i < this->nodes.size(); i++) {
+    this->nodes[i]->set_notify_policy(policy);
+  }
+  if (this->coarse != NULL) {
+    this->coarse->set_notify_policy(policy);
+  }
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::set_cancellation_token(CancellationToken* token) {
+  for (size_t i = 0; i < this->nodes.size(); i++) {
+    this->nodes[i]->set_cancellation_token(token);
+  }
+  if (this->coarse != NULL) {
+    this->coarse->set_cancellation_token(token);
+  }
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::set_memory_budget(MemoryBudget* budget) {
+  for (size_t i = 0; i < this->nodes.size(); i++) {
+    this->nodes[i]->set_memory_budget(budget);
+  }
+  if (this->coarse != NULL) {
+    this->coarse->set_memory_budget(budget);
+  }
+}
+
+
+template <class NodeType>
+std::vector<long long> StaticDAG<NodeType>::topological_order() {
+  assert(this->frozen);
+  long long V = (long long)this->nodes.size();
+
+  // Walk the DAG forwards from the sources, counting down the
+  // predecessors of each node that are not visited yet.  The ready
+  // nodes are a stack, pushed in reverse so that the first source,
+  // and a node's first successor, are visited first.
+  std::vector<long long> order;
+  order.reserve(V);
+  std::vector<int> waiting(V);
+  std::vector<long long> ready;
+  for (long long i = V - 1; i >= 0; i--) {
+    waiting[i] = this->nodes[i]->num_predecessors();
+    if (waiting[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+
+  while (!ready.empty()) {
+    long long i = ready.back();
+    ready.pop_back();
+    order.push_back(i);
+
+    NodeType* n = this->nodes[i];
+    for (int j = n->num_successors() - 1; j >= 0; j--) {
+      long long s = n->successor(j)->dag_index;
+      waiting[s]--;
+      if (waiting[s] == 0) {
+        ready.push_back(s);
+      }
+    }
+  }
+  // Otherwise, the graph has a cycle.
+  assert((long long)order.size() == V);
+  return order;
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::compute_priorities(const long long* costs) {
+  assert(this->frozen);
+  long long V = (long long)this->nodes.size();
+
+  // Visit the nodes in reverse topological order, so every successor
+  // has its priority before its predecessors look at it.
+  std::vector<long long> order = this->topological_order();
+  StaticNodeColumn<long long>& priority = this->tables.priority;
+  priority.use();
+  for (long long k = V - 1; k >= 0; k--) {
+    long long i = order[k];
+    NodeType* n = this->nodes[i];
+    long long max_succ = 0;
+    for (int j = 0; j < n->num_successors(); j++) {
+      max_succ = std::max(max_succ, priority[n->successor(j)->dag_index]);
+    }
+    priority[i] = ((costs != NULL) ? costs[i] : 1) + max_succ;
+  }
+
+  // Highest priority successors first.
+  nabbit::parallel_for(0, V, [this, &priority](long i) {
+      NodeType* n = this->nodes[i];
+      std::stable_sort(n->frozen_succs,
+                       n->frozen_succs + n->num_frozen_succs,
+                       [&priority](NodeType* a, NodeType* b) {
+                         return priority[a->dag_index] > priority[b->dag_index];
+                       });
+    });
+
+  this->set_notify_policy(NOTIFY_PRIORITY);
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::sink_compute(NodeType* sink) {
+  this->sink_compute(&sink, 1);
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::sink_compute(NodeType* const* sinks,
+                                       int num_sinks) {
+  this->mark_all(sinks, num_sinks, true);
+
+  // Every predecessor of a marked node is marked, so the marked
+  // sources are exactly the marked nodes with no predecessors.
+  NodeType** cone_list = this->cone.data();
+  long cone_size = (long)this->cone.size();
+  nabbit::parallel_for(0, cone_size, [=](long i) {
+      if (cone_list[i]->num_predecessors() == 0) {
+        cone_list[i]->compute_and_notify();
+      }
+    });
+
+  this->clear_cone();
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::recompute(NodeType* dirty) {
+  this->recompute(&dirty, 1);
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::recompute(NodeType* const* dirty, int num_dirty) {
+  this->mark_all(dirty, num_dirty, false);
+
+  // Count the clean predecessors of each marked node as arrived.  A
+  // node whose predecessors are all clean is ready right away.
+  NodeType** cone_list = this->cone.data();
+  long cone_size = (long)this->cone.size();
+  std::vector<char> ready(cone_size, 0);
+  char* ready_list = ready.data();
+  int* marks = this->tables.demand_mark.data();
+  nabbit::parallel_for(0, cone_size, [=](long i) {
+      NodeType* n = cone_list[i];
+      bool is_ready = (n->num_predecessors() == 0);
+      for (int j = 0; j < n->num_predecessors(); j++) {
+        NodeType* pred = n->predecessor(j);
+        if ((marks[pred->dag_index] == 0) && n->arrive_from(pred)) {
+          is_ready = true;
+        }
+      }
+      ready_list[i] = is_ready;
+    });
+
+  std::vector<NodeType*> starts;
+  for (long i = 0; i < cone_size; i++) {
+    if (ready_list[i]) {
+      starts.push_back(cone_list[i]);
+    }
+  }
+  NodeType::compute_sources(starts.data(), (long)starts.size());
+
+  this->clear_cone();
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::coarsen(const long long* costs, long long grain) {
+  assert(this->frozen);
+  assert(grain > 0);
+  this->uncoarsen();
+  long long V = (long long)this->nodes.size();
+
+  // Every predecessor of a node is visited, and has its cluster,
+  // before the node.
+  std::vector<long long> order = this->topological_order();
+  std::vector<long long> cluster_of(V, -1);
+  std::vector<long long> cluster_cost;
+  std::vector<StaticClusterNode*> clusters;
+  for (long long k = 0; k < V; k++) {
+    long long i = order[k];
+    NodeType* n = this->nodes[i];
+    long long cost = (costs != NULL) ? costs[i] : 1;
+    long long c = -1;
+    for (int j = 0; j < n->num_predecessors(); j++) {
+      c = std::max(c, cluster_of[n->predecessor(j)->dag_index]);
+    }
+    if ((c < 0) || (cluster_cost[c] + cost > grain)) {
+      c = (long long)clusters.size();
+      clusters.push_back(new StaticClusterNode(c));
+      cluster_cost.push_back(0);
+    }
+    cluster_of[i] = c;
+    cluster_cost[c] += cost;
+    clusters[c]->add_member(n);
+  }
+
+  // One edge for each pair of clusters with edges between them.
+  long long C = (long long)clusters.size();
+  std::vector<std::vector<long long> > cluster_succs(C);
+  for (long long i = 0; i < V; i++) {
+    NodeType* n = this->nodes[i];
+    for (int j = 0; j < n->num_successors(); j++) {
+      long long d = cluster_of[n->successor(j)->dag_index];
+      if (d != cluster_of[i]) {
+        cluster_succs[cluster_of[i]].push_back(d);
+      }
+    }
+  }
+  this->coarse = new StaticDAG<StaticNabbitNode>();
+  for (long long c = 0; c < C; c++) {
+    std::vector<long long>& succs = cluster_succs[c];
+    std::sort(succs.begin(), succs.end());
+    succs.erase(std::unique(succs.begin(), succs.end()), succs.end());
+    clusters[c]->init_node(std::max((int)succs.size(), 1));
+  }
+  for (long long c = 0; c < C; c++) {
+    for (size_t k = 0; k < cluster_succs[c].size(); k++) {
+      clusters[cluster_succs[c][k]]->add_dep(clusters[c]);
+    }
+  }
+
+  for (long long c = 0; c < C; c++) {
+    StaticClusterNode* cluster = clusters[c];
+    this->coarse->add_node(cluster);
+    NodeType* first = cluster->member(0);
+    cluster->set_notify_policy(first->notify_policy);
+    cluster->set_cancellation_token(first->cancel_token());
+    cluster->set_memory_budget(first->memory_budget());
+    cluster->set_affinity(first->get_affinity());
+    long long estimate = 0;
+    for (int k = 0; k < cluster->num_members(); k++) {
+      estimate = std::max(estimate, cluster->member(k)->get_memory_estimate());
+    }
+    cluster->set_memory_estimate(estimate);
+  }
+  this->coarse->freeze();
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::uncoarsen() {
+  if (this->coarse == NULL) {
+    return;
+  }
+  for (long long c = 0; c < this->coarse->num_nodes(); c++) {
+    delete (StaticClusterNode*)this->coarse->get_node(c);
+  }
+  delete this->coarse;
+  this->coarse = NULL;
+}
+
+template <class NodeType>
+long long StaticDAG<NodeType>::num_clusters() {
+  return (this->coarse != NULL) ? this->coarse->num_nodes() : 0;
+}
+
+
+template <class NodeType>
+DAGTraversalType StaticDAG<NodeType>::choose_traversal(const long long* costs,
+                                                       long long serial_work,
+                                                       long long inline_work) {
+  assert(this->frozen);
+  long long V = (long long)this->nodes.size();
+
+  // Walk the DAG forwards in a depth-first topological order, which
+  // is also the serial order, and record each node's depth.
+  std::vector<long long> order = this->topological_order();
+  std::vector<long long> depth(V, 0);
+  long long total = 0;
+  this->serial_order.resize(V);
+  for (long long k = 0; k < V; k++) {
+    long long i = order[k];
+    NodeType* n = this->nodes[i];
+    this->serial_order[k] = n;
+    total += (costs != NULL) ? costs[i] : 1;
+    for (int j = 0; j < n->num_successors(); j++) {
+      long long s = n->successor(j)->dag_index;
+      depth[s] = std::max(depth[s], depth[i] + 1);
+    }
+  }
+
+  std::vector<long long> level_size;
+  long long width = 0;
+  for (long long i = 0; i < V; i++) {
+    if (depth[i] >= (long long)level_size.size()) {
+      level_size.resize(depth[i] + 1, 0);
+    }
+    level_size[depth[i]]++;
+    width = std::max(width, level_size[depth[i]]);
+  }
+
+  // Then backwards, adding up the work reachable from each node, and
+  // stopping at inline_work.
+  std::vector<long long> reach(V);
+  StaticNodeColumn<long long>& node_work = this->tables.inline_work;
+  if (inline_work > 0) {
+    node_work.use();
+  }
+  for (long long k = V - 1; k >= 0; k--) {
+    long long i = order[k];
+    NodeType* n = this->nodes[i];
+    long long r = (costs != NULL) ? costs[i] : 1;
+    for (int j = 0; (j < n->num_successors()) && (r < inline_work); j++) {
+      r += reach[n->successor(j)->dag_index];
+    }
+    reach[i] = std::min(r, inline_work);
+    node_work.set(i, (r < inline_work) ? r : -1);
+  }
+  this->tables.inline_cutoff = inline_work;
+
+  if ((total <= serial_work) || (width <= 1)) {
+    this->traversal = SERIAL_STATIC_TRAVERSAL;
+  }
+  else {
+    this->traversal = STATIC_NABBIT_TRAVERSAL;
+  }
+  return this->traversal;
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::execute_adaptive() {
+  assert((long long)this->serial_order.size() == this->num_nodes());
+  if ((this->traversal == SERIAL_STATIC_TRAVERSAL) ||
+      (NABBIT_WKR_COUNT <= 1)) {
+    for (size_t k = 0; k < this->serial_order.size(); k++) {
+      this->serial_order[k]->compute_in_order();
+    }
+  }
+  else {
+    this->execute_all();
+  }
+}
+
+template <class NodeType>
+DAGTraversalType StaticDAG<NodeType>::get_traversal() {
+  return this->traversal;
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::compute_levels() {
+  assert(this->frozen);
+  long long V = (long long)this->nodes.size();
+  this->level_nodes.assign(V, NULL);
+  this->level_offsets.clear();
+  this->reset();
+
+  // The sources are level 0.  Then each node of a level counts itself
+  // off its successors, and the successors it counts down to 0 are
+  // appended to the next level.
+  std::copy(this->sources.begin(), this->sources.end(),
+            this->level_nodes.begin());
+  volatile long tail = (long)this->sources.size();
+  NodeType** level = this->level_nodes.data();
+  long start = 0;
+  while (start < tail) {
+    long end = tail;
+    this->level_offsets.push_back(start);
+    nabbit::parallel_for(start, end, [level, &tail](long i) {
+        NodeType* n = level[i];
+        for (int j = 0; j < n->num_successors(); j++) {
+          NodeType* succ = n->successor(j);
+          if (nabbit::atomic_sub_and_fetch(&succ->join_counter, 1) == 0) {
+            level[nabbit::atomic_add_and_fetch(&tail, 1) - 1] = succ;
+          }
+        }
+      });
+    start = end;
+  }
+  this->level_offsets.push_back(start);
+  // Otherwise, the graph has a cycle.
+  assert(start == V);
+  this->reset();
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::execute_levels() {
+  assert(!this->level_offsets.empty());
+  NodeType** level = this->level_nodes.data();
+  for (size_t k = 0; k + 1 < this->level_offsets.size(); k++) {
+    nabbit::parallel_for(this->level_offsets[k], this->level_offsets[k+1],
+                         [level](long i) {
+                           level[i]->compute_in_order();
+                         });
+  }
+}
+
+template <class NodeType>
+long long StaticDAG<NodeType>::num_levels() {
+  if (this->level_offsets.empty()) {
+    return 0;
+  }
+  return (long long)this->level_offsets.size() - 1;
+}
+
+
+template <class NodeType>
+void StaticDAG<NodeType>::execute_and_record() {
+  assert(this->frozen);
+  assert(this->coarse == NULL);
+  long long V = (long long)this->nodes.size();
+  this->replay_nodes.clear();
+  this->replay_offsets.clear();
+
+  StaticNodeTables* t = &this->tables;
+  t->replay_ticket.use();
+  t->replay_worker.use();
+  t->replay_claim.use();
+  for (long long i = 0; i < V; i++) {
+    t->replay_ticket[i] = -1;
+  }
+  volatile long counter = 0;
+  t->record_counter = &counter;
+  try {
+    this->execute_all();
+  }
+  catch (...) {
+    t->record_counter = NULL;
+    throw;
+  }
+  t->record_counter = NULL;
+  // Cancelled nodes have no ticket.
+  if (counter < V) {
+    return;
+  }
+
+  // Sort the nodes by worker, and each worker's nodes by ticket.
+  StaticNodeColumn<long>& ticket = t->replay_ticket;
+  StaticNodeColumn<int>& worker = t->replay_worker;
+  this->replay_nodes = this->nodes;
+  std::sort(this->replay_nodes.begin(), this->replay_nodes.end(),
+            [&ticket, &worker](NodeType* a, NodeType* b) {
+              long long i = a->dag_index;
+              long long j = b->dag_index;
+              if (worker[i] != worker[j]) {
+                return worker[i] < worker[j];
+              }
+              return ticket[i] < ticket[j];
+            });
+  long long Q = (V > 0) ? worker[this->replay_nodes.back()->dag_index] + 1 : 0;
+  this->replay_offsets.assign(Q + 1, 0);
+  for (long long i = 0; i < V; i++) {
+    this->replay_offsets[worker[this->replay_nodes[i]->dag_index] + 1]++;
+  }
+  for (long long q = 0; q < Q; q++) {
+    this->replay_offsets[q + 1] += this->replay_offsets[q];
+  }
+  this->replay_heads.assign(Q, 0);
+}
+
+// Advances the head of task q past the nodes that have been claimed,
+// and returns it.  Any worker may advance it.
+template <class NodeType>
+long StaticDAG<NodeType>::replay_head(long q) {
+  volatile long* heads = this->replay_heads.data();
+  volatile int* claims = this->tables.replay_claim.data();
+  long h = heads[q];
+  long end = (long)this->replay_offsets[q + 1];
+  while ((h < end) && claims[this->replay_nodes[h]->dag_index]) {
+    h++;
+  }
+  heads[q] = h;
+  return h;
+}
+
+// Computes n if it is ready and unclaimed, and then counts it off its
+// successors.  Returns whether n was computed.
+template <class NodeType>
+bool StaticDAG<NodeType>::replay_run(NodeType* n) {
+  if ((n->join_counter != 0) ||
+      !nabbit::int_CAS(&this->tables.replay_claim[n->dag_index], 0, 1)) {
+    return false;
+  }
+  try {
+    n->compute_in_order();
+  }
+  catch (...) {
+    // The other tasks stop where they are.
+    this->replay_aborted = 1;
+    throw;
+  }
+  for (int j = 0; j < n->num_successors(); j++) {
+    nabbit::atomic_sub_and_fetch(&n->successor(j)->join_counter, 1);
+  }
+  return true;
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::replay_task(long q) {
+  long Q = (long)this->replay_heads.size();
+  while (!this->replay_aborted) {
+    long h = this->replay_head(q);
+    if ((h < (long)this->replay_offsets[q + 1]) &&
+        this->replay_run(this->replay_nodes[h])) {
+      continue;
+    }
+
+    // Try the next node of each other task, and stop once every task
+    // has no nodes left to claim.
+    bool stole = false;
+    bool done = (h == (long)this->replay_offsets[q + 1]);
+    for (long k = 1; (k < Q) && !stole; k++) {
+      long v = (q + k) % Q;
+      long hv = this->replay_head(v);
+      if (hv < (long)this->replay_offsets[v + 1]) {
+        done = false;
+        stole = this->replay_run(this->replay_nodes[hv]);
+      }
+    }
+    if (stole) {
+      nabbit::atomic_add_and_fetch(&this->replay_steals, 1);
+    }
+    else if (done) {
+      break;
+    }
+    else {
+      nabbit::system_pause();
+    }
+  }
+}
+
+template <class NodeType>
+void StaticDAG<NodeType>::execute_replay() {
+  assert(this->has_schedule());
+  long Q = (long)this->replay_heads.size();
+  for (long q = 0; q < Q; q++) {
+    this->replay_heads[q] = (long)this->replay_offsets[q];
+  }
+  this->replay_steals = 0;
+  this->replay_aborted = 0;
+
+  NABBIT_SPAWN_SCOPE;
+  for (long q = 0; q < Q; q++) {
+    NABBIT_SPAWN_AT((int)q, this->replay_task(q));
+  }
+  NABBIT_SYNC;
+}
+
+template <class NodeType>
+bool StaticDAG<NodeType>::has_schedule() {
+  return !this->replay_offsets.empty();
+}
+
+template <class NodeType>
+long long StaticDAG<NodeType>::num_replay_steals() {
+  return this->replay_steals;
+}
+
+
+// Marks start[0 .. num_start-1], and then all of their ancestors (or
+// descendants), into cone.
+template <class NodeType>
+void StaticDAG<NodeType>::mark_all(NodeType* const* start, int num_start,
+                                   bool ancestors) {
+  this->tables.demand_mark.use();
+  std::vector<NodeType*> work;
+  for (int i = 0; i < num_start; i++) {
+    assert(start[i]->dag_index >= 0);
+    if (nabbit::int_CAS(&this->tables.demand_mark[start[i]->dag_index], 0, 1)) {
+      work.push_back(start[i]);
+    }
+  }
+  this->cone.clear();
+  this->mark_cone(work, ancestors);
+}
+
+// Unmarks and resets every node in cone.
+template <class NodeType>
+void StaticDAG<NodeType>::clear_cone() {
+  NodeType** cone_list = this->cone.data();
+  int* marks = this->tables.demand_mark.data();
+  nabbit::parallel_for(0, (long)this->cone.size(), [=](long i) {
+      marks[cone_list[i]->dag_index] = 0;
+      cone_list[i]->reset_node();
+    });
+  this->cone.clear();
+}
+
+// Marks the unmarked predecessors (or successors) of the nodes in
+// work, and their ancestors (or descendants), with a depth-first
+// search, and resets each node it visits.  The nodes in work must
+// already be marked.  Whenever the search stack gets long, half of it
+// is split off into a spawned search, as in notify_range().
+template <class NodeType>
+void StaticDAG<NodeType>::mark_cone(std::vector<NodeType*> work,
+                                    bool ancestors) {
+  NABBIT_SPAWN_SCOPE;
+  size_t grain = (size_t)nabbit::parallel_notify_threshold();
+  volatile int* marks = this->tables.demand_mark.data();
+  std::vector<NodeType*> visited;
+  while (!work.empty()) {
+    NodeType* n = work.back();
+    work.pop_back();
+    n->reset_node();
+    visited.push_back(n);
+
+    int degree = ancestors ? n->num_predecessors() : n->num_successors();
+    for (int j = 0; j < degree; j++) {
+      NodeType* next = ancestors ? n->predecessor(j) : n->successor(j);
+      if ((marks[next->dag_index] == 0) &&
+          nabbit::int_CAS(&marks[next->dag_index], 0, 1)) {
+        work.push_back(next);
+      }
+    }
+
+    if (work.size() > 2 * grain) {
+      std::vector<NodeType*> half(work.begin() + work.size() / 2, work.end());
+      work.resize(work.size() / 2);
+      NABBIT_SPAWN(this->mark_cone(half, ancestors));
+    }
+  }
+
+  nabbit::lock_acquire(&this->cone_lock);
+  this->cone.insert(this->cone.end(), visited.begin(), visited.end());
+  nabbit::lock_release(&this->cone_lock);
+  NABBIT_SYNC;
+}
+
+
+template <class NodeType>
+bool StaticDAG<NodeType>::is_frozen() {
+  return this->frozen;
+}
+
+template <class NodeType>
+long long StaticDAG<NodeType>::num_nodes() {
+  return (long long)this->nodes.size();
+}
+
+template <class NodeType>
+long long StaticDAG<NodeType>::num_edges() {
+  if (this->frozen) {
+    return this->E;
+  }
+  long long total = 0;
+  for (size_t i = 0; i < this->nodes.size(); i++) {
+    total += this->nodes[i]->predecessors->size_estimate();
+  }
+  return total;
+}
+
+template <class NodeType>
+NodeType* StaticDAG<NodeType>::get_node(long long i) {
+  assert((i >= 0) && (i < this->num_nodes()));
+  return this->nodes[i];
+}
+
+#endif // __STATIC_DAG_H_
@@ -0,0 +1,389 @@
+/* static_dag_builder.h                   -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __STATIC_DAG_BUILDER_H_
+#define __STATIC_DAG_BUILDER_H_
+
+/**
+ * StaticDAGBuilder builds a frozen StaticDAG directly from lists of
+ * edges, without calling init_node() or add_dep() on each node.
+ *
+ * Usage:
+ *
+ *   StaticDAGBuilder<StaticNabbitNode> builder(num_nodes);
+ *   builder.add_edges(src, dst, count);   // Any number of batches,
+ *                                         // from any threads.
+ *   builder.build(&dag, node_at);
+ *
+ * Nodes are identified by an index in [0, num_nodes).  An edge
+ * (src[k], dst[k]) means dst depends on src.  node_at(i) returns a
+ * pointer to node i, whose key (and any other fields InitNode() reads)
+ * must already be set.
+ *
+ * build() counts in- and out-degrees, takes prefix sums, and
+ * scatters the edges into the StaticDAG's CSR arrays (a parallel
+ * counting sort on each endpoint, without atomic operations; see
+ * sort_edges()).  It then makes one pass over the nodes, which sets
+ * each node's edge slices, join counter and row in the StaticDAG's
+ * side tables, and calls InitNode().  Within a slice, edges are
+ * sorted by node index, so the result does not depend on the order
+ * of the batches.
+ */
+
+#include <assert.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "nabbit_sysdep.h"
+#include "static_dag.h"
+
+template <class NodeType>
+class StaticDAGBuilder {
+
+ public:
+  StaticDAGBuilder(long long num_nodes);
+  ~StaticDAGBuilder();
+
+  // Adds count edges (src[k] -> dst[k]).  The edges are copied, so
+  // the arrays may be reused after the call.  Safe to call from
+  // several threads at once.
+  void add_edges(const long long* src,
+                 const long long* dst,
+                 long long count);
+
+  // Builds the graph into dag, which must be empty.  node_at(i)
+  // returns the NodeType* for node i.
+  template <class F>
+  void build(StaticDAG<NodeType>* dag, const F& node_at);
+
+  // Same as above, for nodes stored in an array.
+  template <class T>
+  void build_from_array(StaticDAG<NodeType>* dag, T* node_array);
+
+  long long num_edges();
+
+ private:
+  struct EdgeBatch {
+    long long count;
+    long long* src;
+    long long* dst;
+  };
+
+  long long V;
+  std::vector<EdgeBatch> batches;
+  std::mutex batch_lock;
+
+  // Counting-sorts the E edges by their destinations (by_dst) or
+  // sources: sets offsets[0 .. V] to the start of each node's slice,
+  // and fills each slice of other[] with the other endpoints of that
+  // node's edges, in no particular order.
+  void sort_edges(bool by_dst, long long E,
+                  long long* offsets, long long* other);
+};
+
+
+// Converts a[0..n-1] into its exclusive prefix sums, and returns the
+// total.  Blocks of the array are summed in parallel.
+inline long long static_dag_prefix_sum(long long* a, long long n) {
+  const long long block = 4096;
+  long long num_blocks = (n + block - 1) / block;
+  if (num_blocks <= 1) {
+    long long total = 0;
+    for (long long i = 0; i < n; i++) {
+      long long val = a[i];
+      a[i] = total;
+      total += val;
+    }
+    return total;
+  }
+
+  long long* block_sums = new long long[num_blocks];
+  nabbit::parallel_for(0, num_blocks, [=](long b) {
+      long long end = std::min(n, (b+1) * block);
+      long long sum = 0;
+      for (long long i = b * block; i < end; i++) {
+        sum += a[i];
+      }
+      block_sums[b] = sum;
+    });
+  long long total = 0;
+  for (long long b = 0; b < num_blocks; b++) {
+    long long val = block_sums[b];
+    block_sums[b] = total;
+    total += val;
+  }
+  nabbit::parallel_for(0, num_blocks, [=](long b) {
+      long long end = std::min(n, (b+1) * block);
+      long long sum = block_sums[b];
+      for (long long i = b * block; i < end; i++) {
+        long long val = a[i];
+        a[i] = sum;
+        sum += val;
+      }
+    });
+  delete[] block_sums;
+  return total;
+}
+
+
+template <class NodeType>
+StaticDAGBuilder<NodeType>::StaticDAGBuilder(long long num_nodes)
+  : V(num_nodes) {
+  assert(num_nodes >= 0);
+}
+
+template <class NodeType>
+StaticDAGBuilder<NodeType>::~StaticDAGBuilder() {
+  for (size_t b = 0; b < this->batches.size(); b++) {
+    delete[] this->batches[b].src;
+    delete[] this->batches[b].dst;
+  }
+}
+
+
+template <class NodeType>
+void StaticDAGBuilder<NodeType>::add_edges(const long long* src,
+                                           const long long* dst,
+                                           long long count) {
+  if (count <= 0) {
+    return;
+  }
+  EdgeBatch batch;
+  batch.count = count;
+  batch.src = new long long[count];
+  batch.dst = new long long[count];
+  for (long long k = 0; k < count; k++) {
+    assert((src[k] >= 0) && (src[k] < this->V));
+    assert((dst[k] >= 0) && (dst[k] < this->V));
+    batch.src[k] = src[k];
+    batch.dst[k] = dst[k];
+  }
+
+  std::lock_guard<std::mutex> guard(this->batch_lock);
+  this->batches.push_back(batch);
+}
+
+
+template <class NodeType>
+long long StaticDAGBuilder<NodeType>::num_edges() {
+  std::lock_guard<std::mutex> guard(this->batch_lock);
+  long long E = 0;
+  for (size_t b = 0; b < this->batches.size(); b++) {
+    E += this->batches[b].count;
+  }
+  return E;
+}
+
+
+template <class NodeType>
+template <class F>
+void StaticDAGBuilder<NodeType>::build(StaticDAG<NodeType>* dag,
+                                       const F& node_at) {
+  assert(!dag->frozen);
+  assert(dag->nodes.empty());
+  const long long V = this->V;
+  const long long num_batches = (long long)this->batches.size();
+  EdgeBatch* batch_list = this->batches.data();
+
+  long long E = 0;
+  for (long long b = 0; b < num_batches; b++) {
+    E += batch_list[b].count;
+  }
+  long long* pred_offsets = new long long[V+1];
+  long long* succ_offsets = new long long[V+1];
+  long long* pred_idx = new long long[E];
+  long long* succ_idx = new long long[E];
+  // Sort the edges into the slices of their destinations, and then
+  // of their sources.
+  this->sort_edges(true, E, pred_offsets, pred_idx);
+  this->sort_edges(false, E, succ_offsets, succ_idx);
+
+  // One pass over the nodes: fill in the node pointers, then
+  // initialize each node as init_node() and add_dep() would have.
+  NodeType** pred_edges = new NodeType*[E];
+  NodeType** succ_edges = new NodeType*[E];
+  dag->nodes.resize(V);
+  NodeType** nodes = dag->nodes.data();
+  nabbit::parallel_for(0, V, [&, nodes](long i) {
+      nodes[i] = node_at(i);
+    });
+  StaticNodeTables* tables = &dag->tables;
+  tables->resize(V);
+  dag->prepare_combining_joins(pred_offsets);
+  nabbit::parallel_for(0, V, [=](long i) {
+      NodeType* n = nodes[i];
+
+      long long p_start = pred_offsets[i];
+      long long p_end = pred_offsets[i+1];
+      std::sort(pred_idx + p_start, pred_idx + p_end);
+      for (long long j = p_start; j < p_end; j++) {
+        pred_edges[j] = nodes[pred_idx[j]];
+      }
+
+      long long s_start = succ_offsets[i];
+      long long s_end = succ_offsets[i+1];
+      std::sort(succ_idx + s_start, succ_idx + s_end);
+      for (long long j = s_start; j < s_end; j++) {
+        succ_edges[j] = nodes[succ_idx[j]];
+      }
+
+      assert(n->predecessors == NULL);
+      assert(n->successors == NULL);
+      n->num_frozen_preds = (int)(p_end - p_start);
+      n->num_frozen_succs = (int)(s_end - s_start);
+      n->frozen_preds = pred_edges + p_start;
+      n->frozen_succs = succ_edges + s_start;
+      n->frozen = true;
+      n->join_tables(tables, i);
+      n->join_counter = n->num_frozen_preds;
+      n->setup_frozen_join();
+
+      // Call user-defined initialization.
+      n->InitNode();
+    });
+  delete[] pred_idx;
+  delete[] succ_idx;
+
+  dag->E = E;
+  dag->pred_offsets = pred_offsets;
+  dag->succ_offsets = succ_offsets;
+  dag->pred_edges = pred_edges;
+  dag->succ_edges = succ_edges;
+  dag->frozen = true;
+  dag->find_sources();
+}
+
+
+// A counting sort in two passes, neither of which needs atomic
+// operations.  The first pass splits the edges into chunks, counts
+// each chunk's edges into buckets of consecutive nodes, and scatters
+// them into bucket order, each chunk from its own offsets.  The
+// second pass sorts each bucket by node, one bucket per task.
+template <class NodeType>
+void StaticDAGBuilder<NodeType>::sort_edges(bool by_dst, long long E,
+                                            long long* offsets,
+                                            long long* other) {
+  const long long V = this->V;
+  const long long chunk_size = 1 << 16;
+  const long long max_buckets = 1024;
+  long long bucket_size = std::max((V + max_buckets - 1) / max_buckets, 1LL);
+  long long K = (V + bucket_size - 1) / bucket_size;
+
+  struct Chunk {
+    const long long* key;
+    const long long* val;
+    long long count;
+  };
+  std::vector<Chunk> chunks;
+  for (size_t b = 0; b < this->batches.size(); b++) {
+    const EdgeBatch& batch = this->batches[b];
+    const long long* key = by_dst ? batch.dst : batch.src;
+    const long long* val = by_dst ? batch.src : batch.dst;
+    for (long long lo = 0; lo < batch.count; lo += chunk_size) {
+      Chunk c = { key + lo, val + lo, std::min(chunk_size, batch.count - lo) };
+      chunks.push_back(c);
+    }
+  }
+  long long C = (long long)chunks.size();
+  const Chunk* chunk_list = chunks.data();
+
+  // counts[k * C + c] is the number of edges of chunk c in bucket k,
+  // and then, after the prefix sum, where chunk c's part of bucket k
+  // starts.
+  long long* counts = new long long[K * C + 1];
+  nabbit::parallel_for(0, C, [=](long c) {
+      for (long long k = 0; k < K; k++) {
+        counts[k * C + c] = 0;
+      }
+      for (long long j = 0; j < chunk_list[c].count; j++) {
+        counts[(chunk_list[c].key[j] / bucket_size) * C + c]++;
+      }
+    });
+  counts[K * C] = static_dag_prefix_sum(counts, K * C);
+  assert(counts[K * C] == E);
+
+  long long* bucket_key = new long long[E];
+  long long* bucket_val = new long long[E];
+  nabbit::parallel_for(0, C, [=](long c) {
+      std::vector<long long> cursor(K);
+      for (long long k = 0; k < K; k++) {
+        cursor[k] = counts[k * C + c];
+      }
+      for (long long j = 0; j < chunk_list[c].count; j++) {
+        long long pos = cursor[chunk_list[c].key[j] / bucket_size]++;
+        bucket_key[pos] = chunk_list[c].key[j];
+        bucket_val[pos] = chunk_list[c].val[j];
+      }
+    });
+
+  // Bucket k holds nodes [k * bucket_size, (k+1) * bucket_size), and
+  // edges [counts[k * C], counts[(k+1) * C]).
+  nabbit::parallel_for(0, K, [=](long k) {
+      long long lo = k * bucket_size;
+      long long hi = std::min(V, lo + bucket_size);
+      long long e_start = counts[k * C];
+      long long e_end = counts[(k + 1) * C];
+      std::vector<long long> cursor(hi - lo, 0);
+      for (long long j = e_start; j < e_end; j++) {
+        cursor[bucket_key[j] - lo]++;
+      }
+      long long pos = e_start;
+      for (long long i = lo; i < hi; i++) {
+        long long degree = cursor[i - lo];
+        offsets[i] = pos;
+        cursor[i - lo] = pos;
+        pos += degree;
+      }
+      for (long long j = e_start; j < e_end; j++) {
+        other[cursor[bucket_key[j] - lo]++] = bucket_val[j];
+      }
+    });
+  offsets[V] = E;
+
+  delete[] counts;
+  delete[] bucket_key;
+  delete[] bucket_val;
+}
+
+
+template <class NodeType>
+template <class T>
+void StaticDAGBuilder<NodeType>::build_from_array(StaticDAG<NodeType>* dag,
+                                                  T* node_array) {
+  this->build(dag, [node_array](long long i) -> NodeType* {
+      return &node_array[i];
+    });
+}
+
+#endif // __STATIC_DAG_BUILDER_H_
@@ -33,9 +33,17 @@
 #ifndef __STATIC_NABBIT_NODE_H_
 #define __STATIC_NABBIT_NODE_H_
 
+#include <algorithm>
+#include <vector>
+
+#include "cancellation_token.h"
+#include "combining_join_counter.h"
 #include "dag_status.h"
 #include "dynamic_array.h"
+#include "memory_budget.h"
 #include "nabbit_sysdep.h"
+#include "output_slot.h"
+#include "static_node_tables.h"
 
 // Debugging flag.
 // #define STATIC_NABBIT_PRINT_DEBUG 1
@@ -43,6 +51,29 @@
 class StaticNabbitNode;
 typedef DynamicArray<StaticNabbitNode*> StaticNabbitNodeArray;
 
+template <class NodeType> class StaticDAG;
+template <class NodeType> class StaticDAGBuilder;
+
+// How a node handles the successors it enables.
+typedef enum {
+  // Spawn every enabled successor.  Along a chain, each node waits
+  // on the spawn of the next, and executors that run a waited-for
+  // task on the waiting thread's stack (oneTBB, OpenMP) nest one
+  // frame per node.  Use NOTIFY_CONTINUE_LAST for long chains.
+  NOTIFY_SPAWN_ALL = 0,
+  // Spawn all but the last enabled successor, which runs next in the
+  // current worker.  This saves a spawn along chains of nodes, and
+  // the successor tends to find its inputs still in cache.
+  NOTIFY_CONTINUE_LAST = 1,
+  // Run the first enabled successor next in the current worker, and
+  // spawn the others in order.  Meant for use after
+  // StaticDAG::compute_priorities(), which sorts each node's
+  // successors by decreasing priority: the most critical successor
+  // runs right away, and the next most critical ones are the first
+  // to be stolen.
+  NOTIFY_PRIORITY = 2
+} StaticNotifyPolicy;
+
 
 class StaticNabbitNode {
 
@@ -66,14 +97,136 @@ class StaticNabbitNode {
   
   void add_child(StaticNabbitNode* child);
   void source_compute();
+
+  // Sets how this node handles the successors it enables.  The
+  // default is NOTIFY_SPAWN_ALL.
+  void set_notify_policy(StaticNotifyPolicy policy);
+
+  // Sets the worker that should preferably compute this node, as a
+  // hint: the node runs on worker (affinity % P).  When another
+  // worker enables the node, it mails the node to that worker instead
+  // of running it.  A negative affinity (the default) means no
+  // preference.  Only the native executor uses the hint.
+  void set_affinity(int affinity);
+  inline int get_affinity();
+
+  // Sets the token that cancels evaluations reaching this node, or
+  // NULL (the default) for none.  See also
+  // StaticDAG::set_cancellation_token().
+  void set_cancellation_token(CancellationToken* token);
+
+  // Sets an estimate of the memory Compute() uses, in bytes, and the
+  // budget that limits the total estimate of the running nodes, or
+  // NULL (the default) for no limit.  See MemoryBudget, and also
+  // StaticDAG::set_memory_budget().
+  void set_memory_estimate(long long bytes);
+  inline long long get_memory_estimate();
+  void set_memory_budget(MemoryBudget* budget);
+
+  // Sets the slot that holds this node's output, for its successors
+  // to read in their Compute().  Each successor counts itself done
+  // with the slot when its Compute() returns.  Call once the node's
+  // edges are final.  Usually called by StaticOutputSlot::attach().
+  void set_output_slot(StaticOutputSlotBase* slot);
+  inline StaticOutputSlotBase* get_output_slot();
+
+  // Restores the join counter to the node's in-degree, and calls
+  // ResetNode(), so that the DAG can be executed again.  See also
+  // StaticDAG::reset().
+  void reset_node();
+
+  // Edge accessors, which work both before and after the node's
+  // StaticDAG has been frozen.  After freezing, the "predecessors"
+  // and "successors" arrays are gone, and edges live in slices of the
+  // StaticDAG's CSR arrays.
+  inline bool is_frozen();
+  inline int num_predecessors();
+  inline StaticNabbitNode* predecessor(int i);
+  inline int num_successors();
+  inline StaticNabbitNode* successor(int i);
+
+  // The node's bottom level, i.e., the cost of the most expensive
+  // path from this node to a sink, including this node.  Only valid
+  // after StaticDAG::compute_priorities().
+  inline long long get_priority();
+
+  // True if the node counts its predecessors with a
+  // CombiningJoinCounter instead of join_counter.  Frozen nodes with
+  // more than nabbit::combining_join_threshold() predecessors do.
+  inline bool has_combining_join();
   
  protected:
   virtual void InitNode() = 0;
   virtual void Compute() = 0;
 
+  // Nodes that set folds_predecessors have FoldPredecessor(pred)
+  // called for each predecessor, on that predecessor's worker, as soon
+  // as the predecessor finishes, and before it is counted as done.
+  // See StaticReductionNode.
+  bool folds_predecessors;
+  virtual void FoldPredecessor(StaticNabbitNode* pred) { (void)pred; }
+
+  // Called once the node is frozen and its edges are final, for
+  // nodes that size per-run state up front, so that resetting it
+  // does not allocate.
+  virtual void FreezeNode() { }
+
+  // Called by reset_node(), and when the node is frozen, for nodes
+  // that keep state between runs that a cancelled or throwing run may
+  // leave behind.  Should not allocate.
+  virtual void ResetNode() { }
+
  private:
   volatile long join_counter;
   void compute_and_notify();
+  void notify_range(int lo, int hi);
+  inline bool prefers_other_worker();
+  inline bool arrive_from(StaticNabbitNode* pred);
+  void setup_frozen_join();
+  static void compute_sources(StaticNabbitNode* const* sources, long n);
+
+  // Computes this node without join counters, as a member of a
+  // StaticClusterNode or in a serial StaticDAG::execute_adaptive().
+  friend class StaticClusterNode;
+  void compute_in_order();
+
+  // Set by StaticDAG::freeze() or StaticDAGBuilder::build().
+  template <class NodeType> friend class StaticDAG;
+  template <class NodeType> friend class StaticDAGBuilder;
+  bool frozen;
+  StaticNotifyPolicy notify_policy;
+  int num_frozen_preds;
+  int num_frozen_succs;
+  StaticNabbitNode** frozen_preds;
+  StaticNabbitNode** frozen_succs;
+
+  // Everything else about the node lives in the side tables of its
+  // StaticDAG, at row dag_index, the node's position in the DAG.  A
+  // node that is not registered yet gets a one-row table of its own
+  // from the first setter that needs one, and dag_index stays -1.
+  // See StaticNodeTables.
+  StaticNodeTables* tables;
+  long long dag_index;
+  inline long long table_row();
+  StaticNodeTables* own_tables();
+  void join_tables(StaticNodeTables* dag_tables, long long index);
+
+  inline CancellationToken* cancel_token();
+  inline MemoryBudget* memory_budget();
+  inline bool reads_outputs();
+  inline long long inline_work();
+  inline StaticNestedRun* nested_run();
+  void release_inputs();
+
+  // The steps of compute_and_notify() around Compute().
+  inline bool start_compute(std::vector<StaticNabbitNode*>* resumed);
+  inline void record_start();
+  inline void release_memory(std::vector<StaticNabbitNode*>* resumed);
+  inline void set_memory_admitted();
+  inline StaticNabbitNode* completed_parent();
+
+  // True if this node is part of a sink_compute() and succ is not.
+  inline bool skips_successor(StaticNabbitNode* succ);
 
 };
 
@@ -81,13 +234,31 @@ class StaticNabbitNode {
 StaticNabbitNode::StaticNabbitNode(long long k) 
   :  key(k),
      predecessors(NULL),
-     successors(NULL) {
+     successors(NULL),
+     folds_predecessors(false),
+     frozen(false),
+     notify_policy(NOTIFY_SPAWN_ALL),
+     num_frozen_preds(0),
+     num_frozen_succs(0),
+     frozen_preds(NULL),
+     frozen_succs(NULL),
+     tables(NULL),
+     dag_index(-1) {
 }
 
 StaticNabbitNode::StaticNabbitNode(long long k, int num_predecessors) 
   :  key(k),
      predecessors(NULL),
-     successors(NULL) {
+     successors(NULL),
+     folds_predecessors(false),
+     frozen(false),
+     notify_policy(NOTIFY_SPAWN_ALL),
+     num_frozen_preds(0),
+     num_frozen_succs(0),
+     frozen_preds(NULL),
+     frozen_succs(NULL),
+     tables(NULL),
+     dag_index(-1) {
     (void)num_predecessors; // UNUSED parameter.
 }
 
@@ -99,6 +270,10 @@ StaticNabbitNode::~StaticNabbitNode() {
   if (this->successors != NULL) {
     delete this->successors;
   }
+  // A registered node's tables belong to its StaticDAG.
+  if (this->dag_index < 0) {
+    delete this->tables;
+  }
 }
 
 
@@ -124,6 +299,7 @@ void StaticNabbitNode::init_node() {
 
 // Both "this" node and dep_node should have been initialized already.
 void StaticNabbitNode::add_dep(StaticNabbitNode* dep_node) {
+  assert(!this->frozen && !dep_node->frozen);
 
   // Add an edge from dep_node -> this.
   this->predecessors->add(dep_node);
@@ -133,6 +309,7 @@ void StaticNabbitNode::add_dep(StaticNabbitNode* dep_node) {
 }
 
 void StaticNabbitNode::add_child(StaticNabbitNode* dep_node) {
+  assert(!this->frozen && !dep_node->frozen);
   // Add an edge from dep_node -> this.
   this->predecessors->add(dep_node);
   dep_node->successors->add(this);
@@ -146,46 +323,606 @@ void StaticNabbitNode::source_compute(void) {
 }
 
 
+long long StaticNabbitNode::table_row() {
+  return (this->dag_index >= 0) ? this->dag_index : 0;
+}
+
+// The tables to write this node's settings to.
+StaticNodeTables* StaticNabbitNode::own_tables() {
+  if (this->tables == NULL) {
+    assert(this->dag_index < 0);
+    this->tables = new StaticNodeTables();
+    this->tables->resize(1);
+  }
+  return this->tables;
+}
+
+// Called by StaticDAG::add_node() and StaticDAGBuilder::build(), to
+// make this node row index of dag_tables.
+void StaticNabbitNode::join_tables(StaticNodeTables* dag_tables,
+                                   long long index) {
+  assert(index >= 0);
+  if ((this->dag_index < 0) && (this->tables != NULL)) {
+    dag_tables->merge(index, this->tables);
+    delete this->tables;
+  }
+  this->tables = dag_tables;
+  this->dag_index = index;
+}
+
+
+void StaticNabbitNode::set_notify_policy(StaticNotifyPolicy policy) {
+  this->notify_policy = policy;
+}
+
+void StaticNabbitNode::set_affinity(int affinity) {
+  if ((affinity >= 0) || (this->tables != NULL)) {
+    this->own_tables()->affinity.set(this->table_row(), affinity);
+  }
+}
+
+int StaticNabbitNode::get_affinity() {
+  if (this->tables == NULL) {
+    return -1;
+  }
+  return this->tables->affinity.get(this->table_row());
+}
+
+void StaticNabbitNode::set_cancellation_token(CancellationToken* token) {
+  if ((token != NULL) || (this->tables != NULL)) {
+    this->own_tables()->cancel_token.set(this->table_row(), token);
+  }
+}
+
+CancellationToken* StaticNabbitNode::cancel_token() {
+  if (this->tables == NULL) {
+    return NULL;
+  }
+  return this->tables->cancel_token.get(this->table_row());
+}
+
+void StaticNabbitNode::set_memory_estimate(long long bytes) {
+  assert(bytes >= 0);
+  if ((bytes > 0) || (this->tables != NULL)) {
+    this->own_tables()->memory_estimate.set(this->table_row(), bytes);
+  }
+}
+
+long long StaticNabbitNode::get_memory_estimate() {
+  if (this->tables == NULL) {
+    return 0;
+  }
+  return this->tables->memory_estimate.get(this->table_row());
+}
+
+void StaticNabbitNode::set_memory_budget(MemoryBudget* budget) {
+  if ((budget != NULL) || (this->tables != NULL)) {
+    StaticNodeTables* t = this->own_tables();
+    t->memory_budget.set(this->table_row(), budget);
+    if (t->memory_budget.in_use()) {
+      t->memory_admitted.use();
+    }
+  }
+}
+
+MemoryBudget* StaticNabbitNode::memory_budget() {
+  if (this->tables == NULL) {
+    return NULL;
+  }
+  return this->tables->memory_budget.get(this->table_row());
+}
+
+void StaticNabbitNode::set_output_slot(StaticOutputSlotBase* slot) {
+  if ((slot == NULL) && (this->tables == NULL)) {
+    return;
+  }
+  this->own_tables()->output_slot.set(this->table_row(), slot);
+  if (slot != NULL) {
+    for (int i = 0; i < this->num_successors(); i++) {
+      StaticNabbitNode* succ = this->successor(i);
+      succ->own_tables()->reads_outputs.set(succ->table_row(), 1);
+    }
+  }
+}
+
+StaticOutputSlotBase* StaticNabbitNode::get_output_slot() {
+  if (this->tables == NULL) {
+    return NULL;
+  }
+  return this->tables->output_slot.get(this->table_row());
+}
+
+bool StaticNabbitNode::reads_outputs() {
+  return (this->tables != NULL) &&
+    this->tables->reads_outputs.get(this->table_row());
+}
+
+// Called once this node is done with its predecessors' outputs.
+void StaticNabbitNode::release_inputs() {
+  for (int i = 0; i < this->num_predecessors(); i++) {
+    StaticOutputSlotBase* slot = this->predecessor(i)->get_output_slot();
+    if (slot != NULL) {
+      slot->consumer_done();
+    }
+  }
+}
+
+long long StaticNabbitNode::inline_work() {
+  if (this->tables == NULL) {
+    return -1;
+  }
+  return this->tables->inline_work.get(this->table_row());
+}
+
+StaticNestedRun* StaticNabbitNode::nested_run() {
+  if (this->tables == NULL) {
+    return NULL;
+  }
+  return this->tables->nested_run(this->table_row());
+}
+
+// True if the node has an affinity for a worker other than the
+// calling one.
+bool StaticNabbitNode::prefers_other_worker() {
+#if defined(NABBIT_HAS_EXECUTORS)
+  int affinity = this->get_affinity();
+  if (affinity >= 0) {
+    return (affinity % NABBIT_WKR_COUNT) != NABBIT_WKR_ID;
+  }
+#endif
+  return false;
+}
+
+void StaticNabbitNode::reset_node() {
+  this->join_counter = this->num_predecessors();
+  if (this->tables != NULL) {
+    this->tables->reset_row(this->table_row());
+  }
+  this->ResetNode();
+}
+
+// Called by StaticDAG::freeze() and StaticDAGBuilder::build(), once
+// the node's predecessors are final.  The DAG puts the combining
+// join column in use beforehand, if any node needs it.
+void StaticNabbitNode::setup_frozen_join() {
+  assert(this->frozen);
+  StaticNodeTables* t = this->tables;
+  if ((t != NULL) && t->combining_join.in_use()) {
+    CombiningJoinCounter*& counter = t->combining_join[this->dag_index];
+    delete counter;
+    counter = NULL;
+    if (this->num_frozen_preds > nabbit::combining_join_threshold()) {
+      counter = new CombiningJoinCounter(this->frozen_preds,
+                                         this->num_frozen_preds);
+    }
+  }
+  this->FreezeNode();
+  this->ResetNode();
+}
+
+// Counts the arrival of pred, and returns true if it was the last
+// predecessor this node was waiting for.  Folds in pred first, for
+// nodes that want that.
+bool StaticNabbitNode::arrive_from(StaticNabbitNode* pred) {
+  if (this->folds_predecessors) {
+    this->FoldPredecessor(pred);
+  }
+  StaticNodeTables* t = this->tables;
+  if ((t != NULL) && t->combining_join.in_use()) {
+    CombiningJoinCounter* counter = t->combining_join[this->dag_index];
+    if (counter != NULL) {
+      return counter->arrive(pred);
+    }
+  }
+  assert(this->join_counter > 0);
+  return nabbit::atomic_sub_and_fetch(&(this->join_counter), 1) == 0;
+}
+
+// (A recompute() marks every successor of a marked node.)
+bool StaticNabbitNode::skips_successor(StaticNabbitNode* succ) {
+  StaticNodeTables* t = this->tables;
+  if ((t == NULL) || !t->demand_mark.in_use()) {
+    return false;
+  }
+  return (t->demand_mark[this->dag_index] != 0) &&
+    ((succ->tables == NULL) ||
+     (succ->tables->demand_mark.get(succ->table_row()) == 0));
+}
+
+bool StaticNabbitNode::is_frozen() {
+  return this->frozen;
+}
+
+int StaticNabbitNode::num_predecessors() {
+  if (this->frozen) {
+    return this->num_frozen_preds;
+  }
+  return this->predecessors->size_estimate();
+}
+
+StaticNabbitNode* StaticNabbitNode::predecessor(int i) {
+  if (this->frozen) {
+    return this->frozen_preds[i];
+  }
+  return this->predecessors->get(i);
+}
+
+int StaticNabbitNode::num_successors() {
+  if (this->frozen) {
+    return this->num_frozen_succs;
+  }
+  return this->successors->size_estimate();
+}
+
+StaticNabbitNode* StaticNabbitNode::successor(int i) {
+  if (this->frozen) {
+    return this->frozen_succs[i];
+  }
+  return this->successors->get(i);
+}
+
+long long StaticNabbitNode::get_priority() {
+  if (this->tables == NULL) {
+    return 0;
+  }
+  return this->tables->priority.get(this->table_row());
+}
+
+bool StaticNabbitNode::has_combining_join() {
+  return (this->tables != NULL) &&
+    (this->tables->combining_join.get(this->table_row()) != NULL);
+}
+
+
 /***************************************************************/
 // Methods which call Compute() and do bookkeepping.
 
+// Called after every predecessor of this node has been computed, by
+// a StaticClusterNode (whose earlier members, or earlier clusters,
+// computed them), or by a serial StaticDAG::execute_adaptive().  The
+// predecessors do not arrive one at a
+// time, so a node that folds them does so here, before Compute().
+void StaticNabbitNode::compute_in_order() {
+  CancellationToken* token = this->cancel_token();
+  if (!CancellationToken::is_cancelled(token)) {
+    if (this->folds_predecessors) {
+      for (int i = 0; i < this->num_predecessors(); i++) {
+	this->FoldPredecessor(this->predecessor(i));
+      }
+    }
+    try {
+      this->Compute();
+    }
+    catch (...) {
+      if (token != NULL) {
+        token->cancel();
+      }
+      throw;
+    }
+  }
+  if (this->reads_outputs()) {
+    this->release_inputs();
+  }
+
+  // No engine is waiting to notify this node's successors, so run its
+  // nested DAG, if any, to the end here.  The extra count keeps the
+  // nested sinks from enabling this node.
+  StaticNestedRun* run = this->nested_run();
+  if ((run != NULL) && (run->sources != NULL)) {
+    StaticNabbitNode* const* sources = run->sources;
+    StaticNodeTables* inner = run->inner;
+    run->sources = NULL;
+    nabbit::atomic_add_and_fetch(&inner->nested_pending, 1);
+    StaticNabbitNode::compute_sources(sources, run->num_sources);
+    inner->reset_nested();
+  }
+}
+
+// Returns whether the node can be computed now.  Once its token is
+// cancelled, the node drains instead: it releases what it holds, and
+// enables nothing else.  A node that does not fit in its memory
+// budget yet is parked, until a node that releases memory resumes it.
+bool StaticNabbitNode::start_compute(std::vector<StaticNabbitNode*>* resumed) {
+  StaticNodeTables* t = this->tables;
+  if (t == NULL) {
+    return true;
+  }
+  long long row = this->table_row();
+  MemoryBudget* budget = t->memory_budget.get(row);
+  if (CancellationToken::is_cancelled(t->cancel_token.get(row))) {
+    if (this->reads_outputs()) {
+      this->release_inputs();
+    }
+    if ((budget != NULL) && t->memory_admitted[row]) {
+      this->release_memory(resumed);
+    }
+    return false;
+  }
+  if ((budget != NULL) && !t->memory_admitted[row] &&
+      !budget->admit(this, t->memory_estimate.get(row), resumed)) {
+    return false;
+  }
+  return true;
+}
+
+// Numbers the node, if StaticDAG::execute_and_record() is running.
+void StaticNabbitNode::record_start() {
+  StaticNodeTables* t = this->tables;
+  if ((t != NULL) && (t->record_counter != NULL)) {
+    t->replay_ticket[this->dag_index] =
+      nabbit::atomic_add_and_fetch(t->record_counter, 1) - 1;
+    // A thread that is not a worker has no id; its nodes go to the
+    // first task.
+    t->replay_worker[this->dag_index] = std::max((int)NABBIT_WKR_ID, 0);
+  }
+}
+
+// Returns the node's estimate to its memory budget, if it has one.
+// Nodes resumed by that go in resumed, not yet admitted.
+void StaticNabbitNode::release_memory(std::vector<StaticNabbitNode*>* resumed) {
+  MemoryBudget* budget = this->memory_budget();
+  if (budget != NULL) {
+    this->tables->memory_admitted[this->table_row()] = 0;
+    budget->release(this->get_memory_estimate(), resumed);
+  }
+}
+
+// For nodes resumed from a memory budget, which has admitted them.
+void StaticNabbitNode::set_memory_admitted() {
+  this->tables->memory_admitted[this->table_row()] = 1;
+}
+
+// Called once this node has notified its successors.  If the node is
+// a sink of a nested DAG (see StaticDAG::execute_nested()), and the
+// last of them to finish, returns the DAG's parent, which is to be
+// enabled again to notify its own successors.  Otherwise NULL.
+StaticNabbitNode* StaticNabbitNode::completed_parent() {
+  StaticNodeTables* t = this->tables;
+  if ((t == NULL) || (t->nested_parent == NULL) ||
+      (this->num_successors() != 0)) {
+    return NULL;
+  }
+  StaticNabbitNode* parent = t->nested_parent;
+  if (nabbit::atomic_sub_and_fetch(&t->nested_pending, 1) != 0) {
+    return NULL;
+  }
+  t->nested_parent = NULL;
+  parent->nested_run()->done = true;
+  return parent;
+}
+
 void StaticNabbitNode::compute_and_notify() {
 
-#if STATIC_NABBIT_PRINT_DEBUG == 1
-  printf("COMPUTE AND NOTIFY called on key %lld, worker %d\n",
-  	 this->key,
-	 NABBIT_WKR_ID);
+  // Enabled nodes that run in this loop, instead of being spawned.
+  // Enabling a node spawns it into this function's spawn scope, so
+  // it is a macro rather than a helper.
+  std::vector<StaticNabbitNode*> ready;
+#if defined(NABBIT_SERIALIZE)
+  // In a serialized build, each spawn would be a nested call, one
+  // level of recursion per node.  Keep all the enabled successors on
+  // the worklist instead.
+#   define STATIC_NABBIT_ENABLE(n) ready.push_back(n)
+#else
+  NABBIT_SPAWN_SCOPE;
+  // Nodes with little work reachable from them (see
+  // StaticDAG::choose_traversal()) are not worth a spawn.  They go on
+  // the worklist, until their work adds up to their cutoff.  The
+  // successors of an inline node are part of its work already, so
+  // they do not count again.
+  long long inlined = 0;
+#   define STATIC_NABBIT_ENABLE(n)                                       \
+  do {                                                                  \
+    StaticNabbitNode* e_ = (n);                                         \
+    long long work_ = e_->inline_work();                                \
+    if (work_ < 0) {                                                    \
+      NABBIT_SPAWN_AT(e_->get_affinity(), e_->compute_and_notify());    \
+    }                                                                   \
+    else if ((current != NULL) && (current->inline_work() >= 0)) {      \
+      ready.push_back(e_);                                              \
+    }                                                                   \
+    else if (inlined + work_ < e_->tables->inline_cutoff) {             \
+      inlined += work_;                                                 \
+      ready.push_back(e_);                                              \
+    }                                                                   \
+    else {                                                              \
+      NABBIT_SPAWN_AT(e_->get_affinity(), e_->compute_and_notify());    \
+    }                                                                   \
+  } while (0)
 #endif
-  this->Compute();
-  
-  int end_to_notify = this->successors->size_estimate();
 
-  // Handle the current range of values in the blocking array.
-  //    cilk_for (int i = this->notify_counter; i < end_to_notify; i++) {
-  for (int i = 0; i < end_to_notify; i++) {
+  // With NOTIFY_CONTINUE_LAST (or NOTIFY_PRIORITY), the last (or
+  // first) successor enabled by a node becomes the next iteration of
+  // this loop, instead of a spawn.
+  StaticNabbitNode* current = this;
+  std::vector<StaticNabbitNode*> resumed;
+  while (true) {
+    if ((current == NULL) && !ready.empty()) {
+      current = ready.back();
+      ready.pop_back();
+    }
+    if (current == NULL) {
+      break;
+    }
+#if STATIC_NABBIT_PRINT_DEBUG == 1
+    printf("COMPUTE AND NOTIFY called on key %lld, worker %d\n",
+	   current->key,
+	   NABBIT_WKR_ID);
+#endif
+    StaticNabbitNode* next = NULL;
 
-    StaticNabbitNode* current_succ = this->successors->get(i);
-    if (current_succ->join_counter <= 0) {
-      /*printf("ERROR: this key = %lld, current_succ = %p (key = %lld), join counter = %ld\n",
-	     this->key,
-	     current_succ, current_succ->key,
-	     current_succ->join_counter);*/
-        //printf("ERROR: negative join counter!\n"); // even this gives "function not inlinable..." in g++ 4.9.1
+    // A node whose nested DAG just finished has been computed already,
+    // and only has its successors left to notify.
+    StaticNestedRun* run = current->nested_run();
+    if ((run != NULL) && run->done) {
+      run->done = false;
+    }
+    else if (!current->start_compute(&resumed)) {
+      current = NULL;
     }
-    assert(current_succ->join_counter > 0);
-    int updated_val = nabbit::atomic_sub_and_fetch(&(current_succ->join_counter),
-                                                   1);
+    else {
+      current->record_start();
+      try {
+	current->Compute();
+      }
+      catch (...) {
+	CancellationToken* token = current->cancel_token();
+	if (token != NULL) {
+	  token->cancel();
+	}
+	// Nodes resumed here, and nodes left on the worklist, get
+	// spawns of their own, and drain there if the token was set.
+	current->release_memory(&resumed);
+	for (size_t i = 0; i < resumed.size(); i++) {
+	  resumed[i]->set_memory_admitted();
+	  ready.push_back(resumed[i]);
+	}
+	for (size_t i = 0; i < ready.size(); i++) {
+	  StaticNabbitNode* r = ready[i];
+	  NABBIT_SPAWN_AT(r->get_affinity(), r->compute_and_notify());
+	}
+	throw;
+      }
+
+      if (current->reads_outputs()) {
+	current->release_inputs();
+      }
+      // Compute() has returned its memory.
+      current->release_memory(&resumed);
+
+      // Compute() started a nested DAG, which completes this node.
+      run = current->nested_run();
+      if ((run != NULL) && (run->sources != NULL)) {
+	StaticNabbitNode* const* sources = run->sources;
+	run->sources = NULL;
+	NABBIT_SPAWN(StaticNabbitNode::compute_sources(sources,
+						       run->num_sources));
+	current = NULL;
+      }
+    }
+
+    if (current != NULL) {
+      bool continue_last = (current->notify_policy == NOTIFY_CONTINUE_LAST);
+      bool continue_first = (current->notify_policy == NOTIFY_PRIORITY);
+      int end_to_notify = current->num_successors();
+
+#if !defined(NABBIT_SERIALIZE)
+      // Split up long successor lists, so that one worker is not left
+      // notifying all of them.  The notify policy only applies to the
+      // serial loop.
+      if (end_to_notify > nabbit::parallel_notify_threshold()) {
+	current->notify_range(0, end_to_notify);
+	end_to_notify = 0;
+      }
+#endif
 
-    if (updated_val == 0) {
+      // Handle the current range of values in the blocking array.
+      for (int i = 0; i < end_to_notify; i++) {
+
+	StaticNabbitNode* current_succ = current->successor(i);
+	if (current->skips_successor(current_succ)) {
+	  continue;
+	}
+	if (current_succ->arrive_from(current)) {
 #if STATIC_NABBIT_PRINT_DEBUG == 1
-      printf("Worker %d enabling current_pred with key = %llu.\n",
-	     NABBIT_WKR_ID,
-	     current_succ->key);
+	  printf("Worker %d enabling current_pred with key = %llu.\n",
+		 NABBIT_WKR_ID,
+		 current_succ->key);
 #endif
-      cilk_spawn current_succ->compute_and_notify();
+	  if (current_succ->prefers_other_worker()) {
+	    // Mail it to its preferred worker.
+	    STATIC_NABBIT_ENABLE(current_succ);
+	  }
+	  else if (continue_last) {
+	    // Spawn the previously enabled successor, and hold on to
+	    // this one in case it is the last.
+	    if (next != NULL) {
+	      STATIC_NABBIT_ENABLE(next);
+	    }
+	    next = current_succ;
+	  }
+	  else if (continue_first && (next == NULL)) {
+	    next = current_succ;
+	  }
+	  else {
+	    STATIC_NABBIT_ENABLE(current_succ);
+	  }
+	}
+      }
+
+      // The last sink of a nested DAG completes the DAG's parent.
+      StaticNabbitNode* parent = current->completed_parent();
+      if (parent != NULL) {
+	if (next == NULL) {
+	  next = parent;
+	}
+	else {
+	  STATIC_NABBIT_ENABLE(parent);
+	}
+      }
+    }
+
+    // Nodes resumed from a memory budget have already been admitted.
+    // If nothing else runs next, the first one does, so that a long
+    // run of parked nodes is not a long chain of nested spawns.
+    for (size_t i = 0; i < resumed.size(); i++) {
+      resumed[i]->set_memory_admitted();
+      if (next == NULL) {
+	next = resumed[i];
+      }
+      else {
+	STATIC_NABBIT_ENABLE(resumed[i]);
+      }
     }
+    resumed.clear();
+    current = next;
+  }
+  NABBIT_SYNC;
+#undef STATIC_NABBIT_ENABLE
+}
+
+
+// Notifies successors [lo, hi), spawning every successor that becomes
+// enabled.  Ranges longer than the parallel notify threshold are
+// split in half, and the halves notified in parallel.
+void StaticNabbitNode::notify_range(int lo, int hi) {
+  NABBIT_SPAWN_SCOPE;
+  int grain = nabbit::parallel_notify_threshold();
+  while (hi - lo > grain) {
+    int mid = lo + (hi - lo) / 2;
+    NABBIT_SPAWN(this->notify_range(mid, hi));
+    hi = mid;
+  }
+
+  for (int i = lo; i < hi; i++) {
+    StaticNabbitNode* current_succ = this->successor(i);
+    if (this->skips_successor(current_succ)) {
+      continue;
+    }
+    if (current_succ->arrive_from(this)) {
+      NABBIT_SPAWN_AT(current_succ->get_affinity(),
+		      current_succ->compute_and_notify());
+    }
+  }
+  NABBIT_SYNC;
+}
+
+
+// Runs the source nodes sources[0 .. n-1], for StaticDAG::execute_all().
+// Splits the list in half until one source is left, and spawns one
+// half while recursing on the other, so that every worker can have a
+// source to start from after O(log n) spawns.
+void StaticNabbitNode::compute_sources(StaticNabbitNode* const* sources,
+                                       long n) {
+  NABBIT_SPAWN_SCOPE;
+  while (n > 1) {
+    long half = n / 2;
+    NABBIT_SPAWN(StaticNabbitNode::compute_sources(sources + half, n - half));
+    n = half;
+  }
+  if (n == 1) {
+    sources[0]->compute_and_notify();
   }
-  cilk_sync;
+  NABBIT_SYNC;
 }
 
 #endif // __STATIC_NABBIT_NODE_H_
@@ -0,0 +1,327 @@
+/* static_node_tables.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __STATIC_NODE_TABLES_H_
+#define __STATIC_NODE_TABLES_H_
+
+/**
+ * The optional state of the StaticNabbitNodes of a StaticDAG, kept
+ * out of the nodes themselves: one column per feature, indexed by
+ * each node's position in the DAG.  A column stays empty, and takes
+ * no memory, until some node needs a value other than its default,
+ * so a DAG that uses none of the features below costs nothing beyond
+ * its CSR edge arrays.
+ *
+ * Columns are put in use by setup code (the node setters, freeze(),
+ * compute_priorities() and so on), never while the DAG runs, except
+ * for the nested runs, which are allocated under a lock by
+ * StaticDAG::execute_nested().
+ *
+ * A node that is not registered with a StaticDAG yet keeps its
+ * settings in a one-row table of its own, which is merged into the
+ * DAG's table when it is registered.
+ */
+
+#include <assert.h>
+#include <atomic>
+#include <vector>
+
+#include "combining_join_counter.h"
+#include "nabbit_sysdep.h"
+
+class CancellationToken;
+class MemoryBudget;
+class StaticNabbitNode;
+class StaticOutputSlotBase;
+class StaticNodeTables;
+
+// One column of a StaticNodeTables.
+template <class T>
+class StaticNodeColumn {
+
+ public:
+  StaticNodeColumn(const long long* rows, const T& default_value)
+    : rows(rows), default_value(default_value) { }
+
+  bool in_use() const { return !this->values.empty(); }
+
+  // The value of row i, or the default if the column is not in use.
+  T get(long long i) const {
+    return this->values.empty() ? this->default_value : this->values[i];
+  }
+
+  // Sets row i, putting the column in use first unless value is the
+  // default.
+  void set(long long i, const T& value) {
+    if (this->values.empty() && (value == this->default_value)) {
+      return;
+    }
+    this->use();
+    this->values[i] = value;
+  }
+
+  // Row i of a column in use.
+  T& operator[](long long i) { return this->values[i]; }
+  T* data() { return this->values.data(); }
+
+  // Puts the column in use, with every row at its default.
+  void use() {
+    if (this->values.empty()) {
+      this->values.assign(*this->rows, this->default_value);
+    }
+  }
+
+ private:
+  friend class StaticNodeTables;
+  const long long* rows;
+  std::vector<T> values;
+  T default_value;
+
+  void resize() {
+    if (!this->values.empty()) {
+      this->values.resize(*this->rows, this->default_value);
+    }
+  }
+};
+
+
+// Set on a parent node by StaticDAG::execute_nested(), for the nested
+// DAG that completes it.
+struct StaticNestedRun {
+  StaticNabbitNode* const* sources;
+  long num_sources;
+  // The tables of the nested DAG, which count its sinks.
+  StaticNodeTables* inner;
+  // Set by the last sink of the nested DAG, when the parent is
+  // enabled again to notify its successors.
+  bool done;
+};
+
+
+class StaticNodeTables {
+
+ public:
+  StaticNodeTables();
+  ~StaticNodeTables();
+
+  long long size() { return this->num_rows; }
+
+  // Grows (or shrinks) every column in use to n rows.
+  void resize(long long n);
+
+  // Copies the settings of row 0 of other, the one-row table of a
+  // node that was not registered yet, into row i.  Safe to call for
+  // different rows at once.
+  void merge(long long i, StaticNodeTables* other);
+
+  // Clears what a run leaves behind in row i: see
+  // StaticNabbitNode::reset_node().  Does not allocate.
+  void reset_row(long long i);
+
+  // Clears the nested DAG counts of a DAG that was cancelled.
+  void reset_nested();
+
+  // Settings, from the StaticNabbitNode setters.
+  StaticNodeColumn<int> affinity;
+  StaticNodeColumn<CancellationToken*> cancel_token;
+  StaticNodeColumn<MemoryBudget*> memory_budget;
+  StaticNodeColumn<long long> memory_estimate;
+  // In use along with memory_budget.  Set while the node holds its
+  // estimate from its budget.
+  StaticNodeColumn<char> memory_admitted;
+  StaticNodeColumn<StaticOutputSlotBase*> output_slot;
+  // Set if some predecessor has an output slot.
+  StaticNodeColumn<char> reads_outputs;
+
+  // Set by StaticDAG::compute_priorities().
+  StaticNodeColumn<long long> priority;
+
+  // Set by StaticDAG::choose_traversal(): an estimate of the work
+  // reachable from each node, if it is below inline_cutoff, or -1 if
+  // the node is always spawned.
+  StaticNodeColumn<long long> inline_work;
+  long long inline_cutoff;
+
+  // Set by StaticDAG::freeze() or StaticDAGBuilder::build(), for
+  // nodes with more than nabbit::combining_join_threshold()
+  // predecessors.  Owned by the table.
+  StaticNodeColumn<CombiningJoinCounter*> combining_join;
+
+  // Set only while StaticDAG::execute_and_record() runs: the counter
+  // that numbers the nodes as they start computing.  Each node keeps
+  // its number and worker for StaticDAG::execute_replay(), which sets
+  // replay_claim once some worker has taken the node.
+  volatile long* record_counter;
+  StaticNodeColumn<long> replay_ticket;
+  StaticNodeColumn<int> replay_worker;
+  StaticNodeColumn<int> replay_claim;
+
+  // Set only while StaticDAG::sink_compute() or recompute() runs, on
+  // the nodes it computes.
+  StaticNodeColumn<int> demand_mark;
+
+  // The nested run of parent node i, or NULL if it has none.
+  StaticNestedRun* nested_run(long long i) {
+    StaticNestedRun* runs = this->nested_runs.load(std::memory_order_acquire);
+    return (runs != NULL) ? &runs[i] : NULL;
+  }
+  // Same, but allocates the nested runs first if needed.  Safe to
+  // call while the DAG runs.
+  StaticNestedRun* use_nested_run(long long i);
+
+  // Set by StaticDAG::execute_nested() on the nested DAG: the parent
+  // node, and the number of sinks that are not done yet.
+  StaticNabbitNode* nested_parent;
+  volatile long nested_pending;
+
+ private:
+  long long num_rows;
+  std::atomic<StaticNestedRun*> nested_runs;
+  // Held while merging a node's table, or allocating nested runs.
+  int lock;
+
+  // Not copyable.
+  StaticNodeTables(const StaticNodeTables&);
+  StaticNodeTables& operator=(const StaticNodeTables&);
+};
+
+
+inline StaticNodeTables::StaticNodeTables()
+  : affinity(&num_rows, -1),
+    cancel_token(&num_rows, NULL),
+    memory_budget(&num_rows, NULL),
+    memory_estimate(&num_rows, 0),
+    memory_admitted(&num_rows, 0),
+    output_slot(&num_rows, NULL),
+    reads_outputs(&num_rows, 0),
+    priority(&num_rows, 0),
+    inline_work(&num_rows, -1),
+    inline_cutoff(0),
+    combining_join(&num_rows, NULL),
+    record_counter(NULL),
+    replay_ticket(&num_rows, -1),
+    replay_worker(&num_rows, 0),
+    replay_claim(&num_rows, 0),
+    demand_mark(&num_rows, 0),
+    nested_parent(NULL),
+    nested_pending(0),
+    num_rows(0),
+    nested_runs(NULL),
+    lock(0) {
+}
+
+inline StaticNodeTables::~StaticNodeTables() {
+  for (size_t i = 0; i < this->combining_join.values.size(); i++) {
+    delete this->combining_join.values[i];
+  }
+  delete[] this->nested_runs.load(std::memory_order_relaxed);
+}
+
+
+inline void StaticNodeTables::resize(long long n) {
+  assert(n >= 0);
+  for (long long i = n; i < (long long)this->combining_join.values.size(); i++) {
+    delete this->combining_join.values[i];
+  }
+  this->num_rows = n;
+  this->affinity.resize();
+  this->cancel_token.resize();
+  this->memory_budget.resize();
+  this->memory_estimate.resize();
+  this->memory_admitted.resize();
+  this->output_slot.resize();
+  this->reads_outputs.resize();
+  this->priority.resize();
+  this->inline_work.resize();
+  this->combining_join.resize();
+  this->replay_ticket.resize();
+  this->replay_worker.resize();
+  this->replay_claim.resize();
+  this->demand_mark.resize();
+
+  // Nested runs only matter while the DAG runs.
+  StaticNestedRun* runs = this->nested_runs.load(std::memory_order_relaxed);
+  if (runs != NULL) {
+    delete[] runs;
+    this->nested_runs.store(NULL, std::memory_order_relaxed);
+  }
+}
+
+inline void StaticNodeTables::merge(long long i, StaticNodeTables* other) {
+  nabbit::lock_acquire(&this->lock);
+  this->affinity.set(i, other->affinity.get(0));
+  this->cancel_token.set(i, other->cancel_token.get(0));
+  this->memory_budget.set(i, other->memory_budget.get(0));
+  if (this->memory_budget.in_use()) {
+    this->memory_admitted.use();
+  }
+  this->memory_estimate.set(i, other->memory_estimate.get(0));
+  this->output_slot.set(i, other->output_slot.get(0));
+  this->reads_outputs.set(i, other->reads_outputs.get(0));
+  nabbit::lock_release(&this->lock);
+}
+
+inline void StaticNodeTables::reset_row(long long i) {
+  if (this->combining_join.in_use() && (this->combining_join[i] != NULL)) {
+    this->combining_join[i]->reset();
+  }
+  if (this->replay_claim.in_use()) {
+    this->replay_claim[i] = 0;
+  }
+  // Left over if a nested DAG was cancelled.
+  StaticNestedRun* run = this->nested_run(i);
+  if (run != NULL) {
+    run->sources = NULL;
+    run->inner = NULL;
+    run->done = false;
+  }
+}
+
+inline void StaticNodeTables::reset_nested() {
+  this->nested_parent = NULL;
+  this->nested_pending = 0;
+}
+
+inline StaticNestedRun* StaticNodeTables::use_nested_run(long long i) {
+  if (this->nested_runs.load(std::memory_order_acquire) == NULL) {
+    nabbit::lock_acquire(&this->lock);
+    if (this->nested_runs.load(std::memory_order_relaxed) == NULL) {
+      StaticNestedRun* runs = new StaticNestedRun[this->num_rows]();
+      this->nested_runs.store(runs, std::memory_order_release);
+    }
+    nabbit::lock_release(&this->lock);
+  }
+  return this->nested_run(i);
+}
+
+#endif // __STATIC_NODE_TABLES_H_
@@ -0,0 +1,168 @@
+/* static_reduction_node.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __STATIC_REDUCTION_NODE_H_
+#define __STATIC_REDUCTION_NODE_H_
+
+/**
+ * A static Nabbit node that reduces the values of its predecessors,
+ * as they finish.
+ *
+ * Instead of waiting for all of its predecessors and then looping
+ * over them in Compute(), a StaticReductionNode has each predecessor
+ * fold its Contribution() into a per-worker partial value as soon as
+ * that predecessor is done.  Compute() then only has to call
+ * merge_partials() to combine the partials, which takes O(P) time
+ * instead of O(in-degree).
+ *
+ * T is the type of the values, and Combine is a functor type with
+ * "T operator()(const T& a, const T& b) const", which must be
+ * associative and commutative, with identity "identity".  Partials
+ * are combined in no particular order.
+ *
+ * A subclass defines InitNode() and Compute(), as usual, and
+ * Contribution(pred), which returns the value for predecessor pred.
+ * Contribution() may run on any worker, concurrently with other
+ * calls, so it should only read pred.
+ */
+
+#include <assert.h>
+#include <vector>
+
+#include "nabbit_sysdep.h"
+#include "static_nabbit_node.h"
+
+template <class T, class Combine>
+class StaticReductionNode : public StaticNabbitNode {
+
+ public:
+  StaticReductionNode(long long k, const T& identity,
+                      const Combine& combine = Combine());
+
+ protected:
+  virtual T Contribution(StaticNabbitNode* pred) = 0;
+
+  // Combines all the partials, and empties them, so the node is
+  // ready for the next run after a StaticDAG::reset().  Should be
+  // called once from Compute().
+  T merge_partials();
+
+  // Sizes the partials for the current executor's workers, once the
+  // node is frozen.  A subclass that overrides this should call it
+  // too.
+  void FreezeNode();
+
+  // Empties the partials, in case predecessors folded into them
+  // during a run that was cancelled or threw before Compute().  Does
+  // not allocate.  A subclass that overrides this should call it too.
+  void ResetNode();
+
+ private:
+  // Worker w folds into partials[w+1], which only it touches, so it
+  // needs no lock.  partials[0] is shared, under its lock, by threads
+  // that are not workers, by every caller before the node is frozen,
+  // and by workers beyond the count the partials were sized for (if
+  // the executor changed since).
+  struct Partial {
+    T value;
+    volatile int lock;
+    char padding[64];
+  };
+
+  T identity;
+  Combine combine;
+  std::vector<Partial> partials;
+
+  void FoldPredecessor(StaticNabbitNode* pred);
+};
+
+
+template <class T, class Combine>
+StaticReductionNode<T, Combine>::StaticReductionNode(long long k,
+                                                     const T& identity_,
+                                                     const Combine& combine_)
+  : StaticNabbitNode(k),
+    identity(identity_),
+    combine(combine_),
+    partials(1) {
+  partials[0].value = identity;
+  partials[0].lock = 0;
+  this->folds_predecessors = true;
+}
+
+
+template <class T, class Combine>
+void StaticReductionNode<T, Combine>::FoldPredecessor(StaticNabbitNode* pred) {
+  T v = this->Contribution(pred);
+  int w = NABBIT_WKR_ID;
+  if ((w >= 0) && ((size_t)w + 1 < partials.size())) {
+    Partial* p = &partials[w + 1];
+    p->value = combine(p->value, v);
+    return;
+  }
+  Partial* p = &partials[0];
+  nabbit::lock_acquire(&p->lock);
+  p->value = combine(p->value, v);
+  nabbit::lock_release(&p->lock);
+}
+
+
+template <class T, class Combine>
+void StaticReductionNode<T, Combine>::FreezeNode() {
+  int P = NABBIT_WKR_COUNT;
+  if ((P > 0) && ((size_t)P + 1 > partials.size())) {
+    partials.resize(P + 1);
+  }
+}
+
+
+template <class T, class Combine>
+void StaticReductionNode<T, Combine>::ResetNode() {
+  for (size_t i = 0; i < partials.size(); i++) {
+    partials[i].value = identity;
+    partials[i].lock = 0;
+  }
+}
+
+
+template <class T, class Combine>
+T StaticReductionNode<T, Combine>::merge_partials() {
+  T total = identity;
+  for (size_t i = 0; i < partials.size(); i++) {
+    total = combine(total, partials[i].value);
+    partials[i].value = identity;
+  }
+  return total;
+}
+
+#endif // __STATIC_REDUCTION_NODE_H_
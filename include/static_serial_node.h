@@ -34,6 +34,8 @@
 #define __STATIC_SERIAL_NODE_H_
 
 
+#include <vector>
+
 #include <dag_status.h>
 #include <dynamic_array.h>
 
@@ -43,6 +45,10 @@
 class StaticSerialNode;
 typedef DynamicArray<StaticSerialNode*> StaticSerialNodeArray;
 
+class StaticNodeTables;
+template <class NodeType> class StaticDAG;
+template <class NodeType> class StaticDAGBuilder;
+
 
 class StaticSerialNode {
 
@@ -65,14 +71,48 @@ class StaticSerialNode {
   
   void add_child(StaticSerialNode* child);
   void source_compute();
+
+  // Restores the join counter to the node's in-degree, so that the
+  // DAG can be executed again.  See also StaticDAG::reset().
+  void reset_node();
+
+  // Edge accessors, which work both before and after the node's
+  // StaticDAG has been frozen.  After freezing, the "predecessors"
+  // and "successors" arrays are gone, and edges live in slices of the
+  // StaticDAG's CSR arrays.
+  inline bool is_frozen();
+  inline int num_predecessors();
+  inline StaticSerialNode* predecessor(int i);
+  inline int num_successors();
+  inline StaticSerialNode* successor(int i);
   
  protected:
   virtual void InitNode() = 0;
   virtual void Compute() = 0;
 
  private:
-  volatile int join_counter; 
+  volatile int join_counter;
   void compute_and_notify();
+  // Nothing to do: a serial node has no contention on its counter.
+  void setup_frozen_join() { }
+  // Nothing to do: a serial node keeps no optional state in its
+  // StaticDAG's tables.
+  void join_tables(StaticNodeTables* tables, long long index) {
+    (void)tables;
+    this->dag_index = index;
+  }
+  static void compute_sources(StaticSerialNode* const* sources, long n);
+
+  // Set by StaticDAG::freeze() or StaticDAGBuilder::build().
+  template <class NodeType> friend class StaticDAG;
+  template <class NodeType> friend class StaticDAGBuilder;
+  bool frozen;
+  // The node's position in its StaticDAG.
+  long long dag_index;
+  int num_frozen_preds;
+  int num_frozen_succs;
+  StaticSerialNode** frozen_preds;
+  StaticSerialNode** frozen_succs;
 
 };
 
@@ -85,13 +125,25 @@ class StaticSerialNode {
 StaticSerialNode::StaticSerialNode(long long k) 
   :  key(k),
      predecessors(NULL),
-     successors(NULL) {
+     successors(NULL),
+     frozen(false),
+     dag_index(-1),
+     num_frozen_preds(0),
+     num_frozen_succs(0),
+     frozen_preds(NULL),
+     frozen_succs(NULL) {
 }
 
 StaticSerialNode::StaticSerialNode(long long k, int num_predecessors) 
   :  key(k),
      predecessors(NULL),
-     successors(NULL) {
+     successors(NULL),
+     frozen(false),
+     dag_index(-1),
+     num_frozen_preds(0),
+     num_frozen_succs(0),
+     frozen_preds(NULL),
+     frozen_succs(NULL) {
     (void)num_predecessors;  // UNUSED parameter. 
 }
 
@@ -127,6 +179,7 @@ void StaticSerialNode::init_node() {
 
 // Both "this" node and dep_node should have been initialized already.
 void StaticSerialNode::add_dep(StaticSerialNode* dep_node) {
+  assert(!this->frozen && !dep_node->frozen);
 
   // Add an edge from dep_node -> this.
   this->predecessors->add(dep_node);
@@ -135,6 +188,7 @@ void StaticSerialNode::add_dep(StaticSerialNode* dep_node) {
 }
 
 void StaticSerialNode::add_child(StaticSerialNode* dep_node) {
+  assert(!this->frozen && !dep_node->frozen);
   // Add an edge from dep_node -> this.
   this->predecessors->add(dep_node);
   dep_node->successors->add(this);
@@ -147,48 +201,125 @@ void StaticSerialNode::source_compute(void) {
 }
 
 
+void StaticSerialNode::reset_node() {
+  this->join_counter = this->num_predecessors();
+}
+
+bool StaticSerialNode::is_frozen() {
+  return this->frozen;
+}
+
+int StaticSerialNode::num_predecessors() {
+  if (this->frozen) {
+    return this->num_frozen_preds;
+  }
+  return this->predecessors->size_estimate();
+}
+
+StaticSerialNode* StaticSerialNode::predecessor(int i) {
+  if (this->frozen) {
+    return this->frozen_preds[i];
+  }
+  return this->predecessors->get(i);
+}
+
+int StaticSerialNode::num_successors() {
+  if (this->frozen) {
+    return this->num_frozen_succs;
+  }
+  return this->successors->size_estimate();
+}
+
+StaticSerialNode* StaticSerialNode::successor(int i) {
+  if (this->frozen) {
+    return this->frozen_succs[i];
+  }
+  return this->successors->get(i);
+}
+
+
 /***************************************************************/
 // Methods which call Compute() and do bookkeepping.
 
+// Runs the DAG in the same order as calling compute_and_notify()
+// recursively on each enabled successor would, but keeps the
+// recursion on an explicit stack, so that the depth of the DAG is
+// limited by memory rather than by the size of the call stack.
 void StaticSerialNode::compute_and_notify() {
 
+  // Each frame is a node that has been computed, and the index of
+  // the next successor for it to notify.
+  struct NotifyFrame {
+    StaticSerialNode* node;
+    int next_succ;
+  };
+  std::vector<NotifyFrame> stack;
+
+  StaticSerialNode* to_compute = this;
+  while (true) {
+    if (to_compute != NULL) {
 #if NABBIT_PRINT_DEBUG == 1
-  printf("COMPUTE AND NOTIFY called on key %llu, worker %d\n",
-  	 this->key,
-	 NABBIT_WKR_ID);
+      printf("COMPUTE AND NOTIFY called on key %llu, worker %d\n",
+	     to_compute->key,
+	     NABBIT_WKR_ID);
 #endif
-  this->Compute();
-  
-  int end_to_notify = this->successors->size_estimate();
-
-  // Handle the current range of values in the blocking array.
-  //    cilk_for (int i = this->notify_counter; i < end_to_notify; i++) {
-  for (int i = 0; i < end_to_notify; i++) {
-
-    StaticSerialNode* current_succ = this->successors->get(i);
-    if (current_succ->join_counter <= 0) {
-      printf("ERROR: this key = %lld, current_succ = %p (key = %lld), join coutner = %d\n",
-	     this->key, 
-	     current_succ, current_succ->key,
-	     current_succ->join_counter);
+      to_compute->Compute();
+      NotifyFrame frame = { to_compute, 0 };
+      stack.push_back(frame);
+      to_compute = NULL;
+    }
+
+    if (stack.empty()) {
+      break;
     }
-    assert(current_succ->join_counter > 0);
 
-    current_succ->join_counter--;
-    int updated_val = current_succ->join_counter;
+    NotifyFrame& top = stack.back();
+    StaticSerialNode* current = top.node;
+    int end_to_notify = current->num_successors();
 
-    if (updated_val == 0) {
+    // Notify successors until one becomes enabled.
+    while ((top.next_succ < end_to_notify) && (to_compute == NULL)) {
+      StaticSerialNode* current_succ = current->successor(top.next_succ);
+      top.next_succ++;
+      if (current_succ->join_counter <= 0) {
+	printf("ERROR: this key = %lld, current_succ = %p (key = %lld), join coutner = %d\n",
+	       current->key, 
+	       current_succ, current_succ->key,
+	       current_succ->join_counter);
+      }
+      assert(current_succ->join_counter > 0);
+
+      current_succ->join_counter--;
+      int updated_val = current_succ->join_counter;
+
+      if (updated_val == 0) {
 
 #if NABBIT_PRINT_DEBUG == 1
-      printf("Worker %d enabling current_pred with key = %lld.\n",
-	     NABBIT_WKR_ID,
-	     current_succ->key);
+	printf("Worker %d enabling current_pred with key = %lld.\n",
+	       NABBIT_WKR_ID,
+	       current_succ->key);
 #endif
-      current_succ->compute_and_notify();
+	to_compute = current_succ;
+      }
+    }
+
+    if (to_compute == NULL) {
+      // All successors notified.
+      stack.pop_back();
     }
   }
 }
 
 
 
+
+// Runs the source nodes sources[0 .. n-1], one after another, for
+// StaticDAG::execute_all().
+void StaticSerialNode::compute_sources(StaticSerialNode* const* sources,
+                                       long n) {
+  for (long i = 0; i < n; i++) {
+    sources[i]->compute_and_notify();
+  }
+}
+
 #endif // __STATIC_SERIAL_NODE_H_
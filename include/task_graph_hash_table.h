@@ -33,13 +33,30 @@
 #ifndef __TASK_GRAPH_HASH_TABLE_H_
 #define __TASK_GRAPH_HASH_TABLE_H_
 
+#include <stddef.h>
+
+#include "cancellation_token.h"
 
 class TaskGraphHashTable {
 
  public:
+  TaskGraphHashTable() : cancel_token(NULL) { }
+
+  // The token that cancels evaluations of the DynamicNabbitNodes in
+  // this table, or NULL (the default) for none.
+  void set_cancellation_token(CancellationToken* token) {
+    this->cancel_token = token;
+  }
+  CancellationToken* get_cancellation_token() {
+    return this->cancel_token;
+  }
+
   virtual void* get_task(long long key) = 0;
   virtual int insert_task_if_absent(long long key) = 0;
 
+ private:
+  CancellationToken* cancel_token;
+
 };
 
 
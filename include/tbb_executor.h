@@ -0,0 +1,133 @@
+/* tbb_executor.h                         -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __TBB_EXECUTOR_H_
+#define __TBB_EXECUTOR_H_
+
+/**
+ * Executor which runs Nabbit tasks on oneTBB.
+ *
+ * Each TaskGroup maps to a tbb::task_group, and execute() runs inside
+ * a tbb::task_arena.  Unlike the native scheduler, when a task
+ * throws, TBB cancels the tasks in the group which have not started
+ * yet.
+ *
+ * The arena has NABBIT_NWORKERS threads, if set, and otherwise the
+ * TBB default.  Setting NABBIT_NWORKERS also raises TBB's global
+ * limit on parallelism to match, if it is lower.
+ */
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+
+#include <tbb/blocked_range.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#include "nabbit_executor.h"
+
+namespace nabbit {
+
+  class TBBExecutor : public Executor {
+   public:
+    TBBExecutor()
+      : arena(requested_worker_count() > 0 ?
+              requested_worker_count() :
+              tbb::task_arena::automatic) {
+      int p = requested_worker_count();
+      const tbb::global_control::parameter max_parallelism =
+        tbb::global_control::max_allowed_parallelism;
+      if ((p > 0) &&
+          ((size_t)p > tbb::global_control::active_value(max_parallelism))) {
+        limit.reset(new tbb::global_control(max_parallelism, p));
+      }
+      arena.initialize();
+    }
+
+    const char* name() const { return "tbb"; }
+
+    int worker_id() {
+      int id = tbb::this_task_arena::current_thread_index();
+      return (id >= 0) ? id : -1;
+    }
+
+    int worker_count() {
+      return arena.max_concurrency();
+    }
+
+    void execute(const std::function<void()>& f) {
+      arena.execute(f);
+    }
+
+    // tbb::task_group is too large to keep inline, so the group state
+    // is just a pointer to it.
+    void group_init(void* state) {
+      *static_cast<tbb::task_group**>(state) = new tbb::task_group();
+    }
+
+    void group_spawn(void* state, std::function<void()>&& f) {
+      (*static_cast<tbb::task_group**>(state))->run(std::move(f));
+    }
+
+    std::exception_ptr group_wait(void* state) {
+      tbb::task_group* g = *static_cast<tbb::task_group**>(state);
+      std::exception_ptr e;
+      try {
+        g->wait();
+      }
+      catch (...) {
+        e = std::current_exception();
+      }
+      delete g;
+      return e;
+    }
+
+    void parallel_for(long lo, long hi, long grain,
+                      const std::function<void(long, long)>& chunk) {
+      tbb::parallel_for(tbb::blocked_range<long>(lo, hi, grain),
+                        [&](const tbb::blocked_range<long>& r) {
+                          chunk(r.begin(), r.end());
+                        });
+    }
+
+   private:
+    std::unique_ptr<tbb::global_control> limit;
+    tbb::task_arena arena;
+  };
+};
+
+#endif // __TBB_EXECUTOR_H_
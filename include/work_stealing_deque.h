@@ -0,0 +1,236 @@
+/* work_stealing_deque.h                  -*-C++-*-
+ *
+ *************************************************************************
+ *
+ * Copyright (c) 2026, Jim Sukha
+ * All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the authors nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WORK_STEALING_DEQUE_H
+#define __WORK_STEALING_DEQUE_H
+
+/**
+ * A Chase-Lev work-stealing deque.
+ *
+ * The owner of the deque pushes and pops at the bottom; any other
+ * thread may steal from the top.  The memory orderings follow the
+ * C11 version of the algorithm by Le, Pop, Cohen and Zappa Nardelli
+ * ("Correct and Efficient Work-Stealing for Weak Memory Models",
+ * PPoPP 2013).
+ *
+ * The deque stores pointers (or other small, trivially copyable
+ * values).  A value of T() is returned by pop() and steal() to
+ * indicate that nothing was taken, so T() should never be pushed.
+ *
+ * When the circular buffer fills up, the owner doubles it.  As with
+ * DynamicArray, the old buffers are kept on a list until the deque is
+ * destroyed, since a concurrent thief may still be reading from them.
+ */
+
+#include <assert.h>
+#include <atomic>
+
+template <class T>
+struct WorkStealingDequeBuffer {
+  long long capacity;
+  long long mask;
+  std::atomic<T>* a;
+  WorkStealingDequeBuffer<T>* next;
+
+  WorkStealingDequeBuffer(long long cap)
+    : capacity(cap),
+      mask(cap - 1),
+      a(new std::atomic<T>[cap]),
+      next(NULL) {
+    // Capacity must be a power of 2.
+    assert((cap & (cap - 1)) == 0);
+  }
+
+  ~WorkStealingDequeBuffer() {
+    delete[] a;
+  }
+
+  T get(long long idx) {
+    return a[idx & mask].load(std::memory_order_relaxed);
+  }
+
+  void put(long long idx, T val) {
+    a[idx & mask].store(val, std::memory_order_relaxed);
+  }
+};
+
+
+template <class T>
+class WorkStealingDeque {
+
+ private:
+  // The top and bottom indices are written by different threads, so
+  // keep them on separate cache lines.
+  std::atomic<long long> top;
+  char top_padding[64];
+  std::atomic<long long> bottom;
+  std::atomic<WorkStealingDequeBuffer<T>*> buffer;
+
+  // Buffers retired by grow(), freed in the destructor.
+  WorkStealingDequeBuffer<T>* old_buffers;
+
+  WorkStealingDequeBuffer<T>* grow(WorkStealingDequeBuffer<T>* old_buf,
+                                   long long b,
+                                   long long t);
+
+ public:
+  WorkStealingDeque(long long init_capacity);
+  ~WorkStealingDeque();
+
+  // Owner-only operations.
+  void push(T val);
+  T pop();
+
+  // May be called by any thread.
+  T steal();
+
+  // Approximate number of elements in the deque.  Exact only when
+  // there are no concurrent operations.
+  long long size_estimate();
+};
+
+
+template <class T>
+WorkStealingDeque<T>::WorkStealingDeque(long long init_capacity)
+  : top(0),
+    bottom(0),
+    old_buffers(NULL) {
+  long long cap = 1;
+  while (cap < init_capacity) {
+    cap *= 2;
+  }
+  buffer.store(new WorkStealingDequeBuffer<T>(cap),
+               std::memory_order_relaxed);
+}
+
+template <class T>
+WorkStealingDeque<T>::~WorkStealingDeque() {
+  while (old_buffers != NULL) {
+    WorkStealingDequeBuffer<T>* next = old_buffers->next;
+    delete old_buffers;
+    old_buffers = next;
+  }
+  delete buffer.load(std::memory_order_relaxed);
+}
+
+
+template <class T>
+WorkStealingDequeBuffer<T>*
+WorkStealingDeque<T>::grow(WorkStealingDequeBuffer<T>* old_buf,
+                           long long b,
+                           long long t) {
+  WorkStealingDequeBuffer<T>* new_buf =
+    new WorkStealingDequeBuffer<T>(2 * old_buf->capacity);
+  for (long long i = t; i < b; i++) {
+    new_buf->put(i, old_buf->get(i));
+  }
+
+  old_buf->next = old_buffers;
+  old_buffers = old_buf;
+  buffer.store(new_buf, std::memory_order_release);
+  return new_buf;
+}
+
+
+template <class T>
+void WorkStealingDeque<T>::push(T val) {
+  long long b = bottom.load(std::memory_order_relaxed);
+  long long t = top.load(std::memory_order_acquire);
+  WorkStealingDequeBuffer<T>* a = buffer.load(std::memory_order_relaxed);
+
+  if (b - t > a->capacity - 1) {
+    a = grow(a, b, t);
+  }
+  a->put(b, val);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+
+template <class T>
+T WorkStealingDeque<T>::pop() {
+  long long b = bottom.load(std::memory_order_relaxed) - 1;
+  WorkStealingDequeBuffer<T>* a = buffer.load(std::memory_order_relaxed);
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  long long t = top.load(std::memory_order_relaxed);
+
+  T val = T();
+  if (t <= b) {
+    val = a->get(b);
+    if (t == b) {
+      // Last element: race against thieves for it.
+      if (!top.compare_exchange_strong(t, t + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        val = T();
+      }
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+  }
+  else {
+    // Deque was empty.
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return val;
+}
+
+
+template <class T>
+T WorkStealingDeque<T>::steal() {
+  long long t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  long long b = bottom.load(std::memory_order_acquire);
+
+  if (t < b) {
+    WorkStealingDequeBuffer<T>* a = buffer.load(std::memory_order_acquire);
+    T val = a->get(t);
+    if (!top.compare_exchange_strong(t, t + 1,
+                                     std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      // Lost the race with another thief or the owner.
+      return T();
+    }
+    return val;
+  }
+  return T();
+}
+
+
+template <class T>
+long long WorkStealingDeque<T>::size_estimate() {
+  long long b = bottom.load(std::memory_order_relaxed);
+  long long t = top.load(std::memory_order_relaxed);
+  return (b > t) ? (b - t) : 0;
+}
+
+#endif // __WORK_STEALING_DEQUE_H
@@ -33,7 +33,7 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <cilk/cilk.h>
+#include <nabbit_sysdep.h>
 
 
 #include <arrays/array2d_row.h>
@@ -32,7 +32,7 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <cilk/cilk.h>
+#include <nabbit_sysdep.h>
 
 
 #include <arrays/convert.h>
@@ -362,26 +362,26 @@ int main(int argc, char *argv[])
         MAX_DIM = 4;
     }
   
-    cilk_for (int n = 1; n < MAX_DIM; n++) {
-        cilk_for (int m = 1; m < MAX_DIM; m++) {
+    nabbit::parallel_for(1, MAX_DIM, [&](long n) {
+        nabbit::parallel_for(1, MAX_DIM, [&](long m) {
       
             if (verbose) {
                 //	printf("Testing n=%d, m=%d ...",
                 //	       n, m);
             }
 
-            cilk_for (int sn = 0; sn < NUM_BSIZES; sn++) {
+            nabbit::parallel_for(0, NUM_BSIZES, [&](long sn) {
                 for (int sm = 0; sm < NUM_BSIZES; sm++) {
                     //	  printf("sn=%d, sm=%d, ... ", bsizes[sn], bsizes[sm]);
                     for (int padding = 0; padding < 10; padding+=3){
                         test_index_calc(n, m, bsizes[sn], bsizes[sm], padding, false);
                     }
                 }
-            }
+            });
 
 
 
-            cilk_for (int sn = 0; sn < NUM_BSIZES; sn++) {
+            nabbit::parallel_for(0, NUM_BSIZES, [&](long sn) {
                 for (int sm = 0; sm < NUM_BSIZES; sm++) {
                     test_conversion(n, m,
                                     bsizes[sn], bsizes[sm], 0,
@@ -392,7 +392,7 @@ int main(int argc, char *argv[])
                                     bsizes[sm], bsizes[sn], 1,
                                     false);	    
                 }
-            }
+            });
 
 
             // Check row-major
@@ -417,10 +417,10 @@ int main(int argc, char *argv[])
       
 
             if (verbose) {
-                printf("n=%d, m=%d ... PASSED\n", n, m);
+                printf("n=%ld, m=%ld ... PASSED\n", n, m);
             }
-        }
-    }
+        });
+    });
      
     return 0;
 }
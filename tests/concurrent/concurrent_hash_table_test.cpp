@@ -1,7 +1,7 @@
 #include <algorithm>
 #include <iostream>
 #include <cstdlib>
-#include <cilk/cilk.h>
+#include <nabbit_sysdep.h>
 
 #include <example_util_gettime.h>
 #include <check_sort.h>
@@ -102,10 +102,13 @@ int main(int argc, char *argv[])
 
 
     long start_time = example_get_time();
-    for (int i = 0; i < 20; i++) {
-        cilk_spawn test_hash_insert(H, R, R/20);
+    {
+        NABBIT_SPAWN_SCOPE;
+        for (int i = 0; i < 20; i++) {
+            NABBIT_SPAWN(test_hash_insert(H, R, R/20));
+        }
+        NABBIT_SYNC;
     }
-    cilk_sync;
     long end_time = example_get_time();
 
     int num_inserts = 20 * (int)(R/20);
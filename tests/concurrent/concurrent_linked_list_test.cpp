@@ -9,7 +9,7 @@
 #include <iostream>
 
 #include <cstdlib>
-#include <cilk/cilk.h>
+#include <nabbit_sysdep.h>
 
 // Included from util directory. 
 #include <check_sort.h>
@@ -124,10 +124,13 @@ int main(int argc, char *argv[])
      std::cout << "An empty linked list\n";
      L->print_list();
 
-     for (int i = 0; i < 20; i++) {
-       cilk_spawn test_list_insert(L, R, 5*R);
+     {
+       NABBIT_SPAWN_SCOPE;
+       for (int i = 0; i < 20; i++) {
+         NABBIT_SPAWN(test_list_insert(L, R, 5*R));
+       }
+       NABBIT_SYNC;
      }
-     cilk_sync;
 
      all_list_insert(L, R);
      check_list_insert(L, R);
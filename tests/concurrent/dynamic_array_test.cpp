@@ -1,7 +1,7 @@
 #include <iostream>
 #include <cstdlib>
 
-#include <cilk/cilk.h>
+#include <nabbit_sysdep.h>
 
 #include <example_util_gettime.h>
 #include <dynamic_array.h>
@@ -44,20 +44,30 @@ void serial_try_get_n(DynamicArray<int>* A, int n) {
 }
 
 void parallel_get(DynamicArray<int>* A, int n, int p) {
-    cilk_for(int i = 0; i < p; i++) {
+    nabbit::parallel_for(0, p, [=](long i) {
         serial_try_get_n(A, n);
-    }  
+    });
 }
 
 void parallel_search_get_test(int n, int p) {
     bool done = false;
     DynamicArray<int>* A = new DynamicArray<int>(2);
-    cilk_spawn serial_try_insert_n(A, n);
+    NABBIT_SPAWN_SCOPE;
+    NABBIT_SPAWN(serial_try_insert_n(A, n));
+
+    // With a help-first scheduler and a single worker, the inserts
+    // cannot start until the sync.  Sync first in that case, which
+    // is the order Cilk would run them in on one worker.
+    if (NABBIT_WKR_COUNT < 2) {
+        NABBIT_SYNC;
+    }
     do {
         parallel_get(A, n, p-1);
         done = (A->size_estimate() == n);
     } while (!done);
-    cilk_sync;
+    NABBIT_SYNC;
+    assert(done);
+    parallel_get(A, n, p-1);
     delete A;
 }			      
 
@@ -150,14 +160,13 @@ void parallel_dynamic_array_benchmark(int n,
     DynamicArray<int>* A = new DynamicArray<int>(init_size);
     assert(A != NULL);
 
-    cilk_for (int i = 0; i < n; i++) {
+    nabbit::parallel_for(0, n, [=](long i) {
         int val = 2*i + 1;
         bool success;
         do {
             success = A->try_atomic_add(val);
         } while (!success);
-    }
-    //  cilk_sync;
+    });
     long end_time = example_get_time();  
     double total_time = (end_time - start_time) * 1.0f;
 
@@ -212,7 +221,9 @@ int main(int argc, char *argv[])
 
     printf("Trying dyn_array_search_get_test\n");
 
-    parallel_search_get_test(R, 10);
+    // The test spawns and spins on its own, so it has to run on the
+    // executor's workers, like any top-level parallel code.
+    nabbit::execute([R]() { parallel_search_get_test(R, 10); });
 
     printf("PASSED\n");
      
@@ -2,7 +2,7 @@
 #include <cstdlib>
 
 
-#include <cilk/cilk.h>
+#include <nabbit_sysdep.h>
 
 
 #include <example_util_gettime.h>
@@ -55,10 +55,13 @@ int main(int argc, char *argv[])
     std::cout << "List length = " << list_length << "\n";
 
     long start_time = example_get_time();
-    for (int i = 0; i < 20; i++) {
-        cilk_spawn list_creation_test(list_length, R);
+    {
+        NABBIT_SPAWN_SCOPE;
+        for (int i = 0; i < 20; i++) {
+            NABBIT_SPAWN(list_creation_test(list_length, R));
+        }
+        NABBIT_SYNC;
     }
-    cilk_sync;
     long end_time = example_get_time();
 
     double running_time = (end_time-start_time) / 1000.f;
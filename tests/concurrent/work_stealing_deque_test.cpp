@@ -0,0 +1,181 @@
+/*
+ * work_stealing_deque_test.cpp
+ *
+ * Testing the work_stealing_deque.h implementation, the native
+ * scheduler built on top of it, and the other executors.
+ *
+ */
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include "work_stealing_deque.h"
+
+
+// Pushes and pops from a single thread.  The deque should behave like
+// a stack, and grow past its initial capacity.
+void serial_deque_test(int R) {
+    WorkStealingDeque<long> D(4);
+    for (long i = 1; i <= R; i++) {
+        D.push(i);
+    }
+    assert(D.size_estimate() == R);
+
+    // Thieves take from the other end.
+    assert(D.steal() == 1);
+    for (long i = R; i >= 2; i--) {
+        long val = D.pop();
+        assert(val == i);
+    }
+    assert(D.pop() == 0);
+    assert(D.steal() == 0);
+    assert(D.size_estimate() == 0);
+    std::cout << "Serial deque test passed\n";
+}
+
+
+// The owner pushes values [1 .. R] and pops some of them back, while
+// T thieves steal concurrently.  Every value must be taken exactly
+// once.
+void concurrent_deque_test(int R, int T) {
+    WorkStealingDeque<long> D(8);
+    std::vector<std::atomic<int> > taken(R + 1);
+    for (int i = 0; i <= R; i++) {
+        taken[i].store(0);
+    }
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < T; t++) {
+        thieves.push_back(std::thread([&]() {
+                    while (true) {
+                        bool finished = done.load();
+                        long val = D.steal();
+                        if (val != 0) {
+                            taken[val]++;
+                        }
+                        else if (finished) {
+                            break;
+                        }
+                    }
+                }));
+    }
+
+    for (long i = 1; i <= R; i++) {
+        D.push(i);
+        if ((i % 3) == 0) {
+            long val = D.pop();
+            if (val != 0) {
+                taken[val]++;
+            }
+        }
+    }
+    // Drain whatever is left.
+    long val;
+    while ((val = D.pop()) != 0) {
+        taken[val]++;
+    }
+    done.store(true);
+    for (int t = 0; t < T; t++) {
+        thieves[t].join();
+    }
+
+    for (int i = 1; i <= R; i++) {
+        assert(taken[i].load() == 1);
+    }
+    std::cout << "Concurrent deque test passed, R = " << R
+              << ", T = " << T << "\n";
+}
+
+
+long fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    long x, y;
+    NABBIT_SPAWN_SCOPE;
+    NABBIT_SPAWN_ASSIGN(x, fib(n-1));
+    y = fib(n-2);
+    NABBIT_SYNC;
+    return x + y;
+}
+
+
+void thrower(int n) {
+    if (n == 0) {
+        throw std::runtime_error("thrower");
+    }
+    NABBIT_SPAWN_SCOPE;
+    NABBIT_SPAWN(thrower(n-1));
+    NABBIT_SPAWN(thrower(n-1));
+    NABBIT_SYNC;
+}
+
+
+// Runs some spawn-heavy code on the scheduler.
+void scheduler_test() {
+    long f = fib(25);
+    assert(f == 75025);
+
+    std::atomic<long> sum(0);
+    nabbit::parallel_for(0, 100000, [&](long i) {
+            sum += i;
+        });
+    assert(sum.load() == 100000L * 99999L / 2);
+
+    // Spawns with a worker hint all run, whether or not the hint is
+    // honored.
+    std::atomic<long> mailed(0);
+    std::atomic<long>* mailed_ptr = &mailed;
+    {
+        NABBIT_SPAWN_SCOPE;
+        for (int i = -1; i < 4 * NABBIT_WKR_COUNT; i++) {
+            NABBIT_SPAWN_AT(i, *mailed_ptr += (fib(10) == 55));
+        }
+        NABBIT_SYNC;
+    }
+    assert(mailed.load() == 4 * NABBIT_WKR_COUNT + 1);
+
+    // An exception in a spawned child is rethrown at the sync.
+    bool caught = false;
+    try {
+        thrower(6);
+    }
+    catch (std::runtime_error& e) {
+        caught = true;
+    }
+    assert(caught);
+    std::cout << "Scheduler test passed, P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+    int R = 100000;
+    if (argc >= 2) {
+        R = atoi(argv[1]);
+    }
+
+    serial_deque_test(1000);
+    concurrent_deque_test(R, 1);
+    concurrent_deque_test(R, 3);
+
+#ifdef NABBIT_HAS_EXECUTORS
+    // Run the same spawns on every executor in this build.
+    for (const char* const* name = nabbit::executor_names(); *name != NULL; name++) {
+        std::cout << "Executor " << *name << ": ";
+        bool found = nabbit::set_executor(*name);
+        assert(found);
+        nabbit::execute([]() { scheduler_test(); });
+    }
+#else
+    scheduler_test();
+#endif
+    return 0;
+}
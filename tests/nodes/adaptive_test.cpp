@@ -0,0 +1,170 @@
+/*
+ * adaptive_test.cpp
+ *
+ * Checks the engine that StaticDAG::choose_traversal() picks for
+ * small, narrow and large DAGs, and that execute_adaptive() computes
+ * every node either way, with and without inline nodes.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+
+const long long ADAPTIVE_MOD = 1000000007LL;
+
+
+// Node (i, j) of a W x W grid adds up the values of (i-1, j) and
+// (i, j-1), plus 1, and records the worker it ran on.  With W = 1,
+// the grid is a chain.
+class GridNode final : public StaticNabbitNode {
+ public:
+  long long value;
+  int worker;
+
+  GridNode(long long k) : StaticNabbitNode(k), value(-1), worker(-1) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    long long v = 1;
+    for (int i = 0; i < this->num_predecessors(); i++) {
+      GridNode* pred = (GridNode*)this->predecessor(i);
+      assert(pred->value >= 0);
+      v += pred->value;
+    }
+    value = v % ADAPTIVE_MOD;
+    worker = NABBIT_WKR_ID;
+  }
+};
+
+
+void build_grid(StaticDAG<StaticNabbitNode>* dag, long long H, long long W) {
+  for (long long k = 0; k < H * W; k++) {
+    GridNode* n = new GridNode(k);
+    n->init_node(2);
+    if (k / W > 0) {
+      n->add_dep(dag->get_node(k - W));
+    }
+    if (k % W > 0) {
+      n->add_dep(dag->get_node(k - 1));
+    }
+    dag->add_node(n);
+  }
+  dag->freeze();
+}
+
+void delete_nodes(StaticDAG<StaticNabbitNode>* dag) {
+  for (long long k = 0; k < dag->num_nodes(); k++) {
+    delete (GridNode*)dag->get_node(k);
+  }
+}
+
+
+// Runs an H x W grid twice with execute_adaptive(), and checks every
+// value against a serial computation.
+void grid_test(long long H, long long W, long long serial_work,
+               long long inline_work, DAGTraversalType expected_type) {
+  StaticDAG<StaticNabbitNode> dag;
+  build_grid(&dag, H, W);
+  DAGTraversalType t = dag.choose_traversal(NULL, serial_work, inline_work);
+  assert(t == expected_type);
+  assert(dag.get_traversal() == expected_type);
+
+  std::vector<long long> expected(H * W);
+  for (long long k = 0; k < H * W; k++) {
+    long long v = 1;
+    if (k / W > 0) { v += expected[k - W]; }
+    if (k % W > 0) { v += expected[k - 1]; }
+    expected[k] = v % ADAPTIVE_MOD;
+  }
+
+  for (int rep = 0; rep < 2; rep++) {
+    for (long long k = 0; k < H * W; k++) {
+      ((GridNode*)dag.get_node(k))->value = -1;
+    }
+    nabbit::execute([&]() { dag.execute_adaptive(); });
+    for (long long k = 0; k < H * W; k++) {
+      assert(((GridNode*)dag.get_node(k))->value == expected[k]);
+    }
+    dag.reset();
+  }
+  delete_nodes(&dag);
+  std::cout << "Adaptive grid test passed, " << H << " x " << W
+            << ", inline work = " << inline_work
+            << ", traversal = " << t
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+// A source, then K chains of L nodes.  Each chain is below the inline
+// cutoff, and the source is not, so the source keeps chains for
+// itself until their work reaches the cutoff, and spawns the rest.
+// Each inline chain then runs on one worker.
+void fan_test(int K, int L, long long inline_work) {
+  StaticDAG<StaticNabbitNode> dag;
+  std::vector<GridNode*> nodes;
+  GridNode* source = new GridNode(0);
+  source->init_node(K);
+  nodes.push_back(source);
+  for (int c = 0; c < K; c++) {
+    for (int i = 0; i < L; i++) {
+      GridNode* n = new GridNode(nodes.size());
+      n->init_node(1);
+      n->add_dep((i == 0) ? source : nodes.back());
+      nodes.push_back(n);
+    }
+  }
+  for (size_t k = 0; k < nodes.size(); k++) {
+    dag.add_node(nodes[k]);
+  }
+  dag.freeze();
+  assert(dag.choose_traversal(NULL, 1, inline_work) == STATIC_NABBIT_TRAVERSAL);
+
+  nabbit::execute([&]() { dag.execute_adaptive(); });
+  int with_source = 0;
+  for (int c = 0; c < K; c++) {
+    GridNode* head = nodes[1 + c * L];
+    for (int i = 0; i < L; i++) {
+      GridNode* n = nodes[1 + c * L + i];
+      assert(n->value == i + 2);
+      if (L < inline_work) {
+        assert(n->worker == head->worker);
+      }
+    }
+    if (head->worker == source->worker) {
+      with_source++;
+    }
+  }
+  // Chains whose work fits under the cutoff stay with the source.
+  assert(with_source >= (inline_work - 1) / L);
+
+  delete_nodes(&dag);
+  std::cout << "Adaptive fan test passed, K = " << K << ", L = " << L
+            << ", chains run with the source = " << with_source
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 128;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  // A chain has width 1, and a small grid is below the serial cutoff.
+  grid_test(100000, 1, 0, 0, SERIAL_STATIC_TRAVERSAL);
+  grid_test(8, 8, 100, 0, SERIAL_STATIC_TRAVERSAL);
+
+  grid_test(W, W, 100, 0, STATIC_NABBIT_TRAVERSAL);
+  grid_test(W, W, 100, 64, STATIC_NABBIT_TRAVERSAL);
+  grid_test(W, W, 100, 1LL << 40, STATIC_NABBIT_TRAVERSAL);
+
+  fan_test(64, 8, 100);
+  fan_test(64, 8, 1);
+  return 0;
+}
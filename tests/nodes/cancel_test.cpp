@@ -0,0 +1,269 @@
+/*
+ * cancel_test.cpp
+ *
+ * Cancels static and dynamic Nabbit evaluations partway through,
+ * either with a CancellationToken or by throwing from Compute().
+ *
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <cancellation_token.h>
+#include <concurrent_hash_table.h>
+#include <dynamic_nabbit_node.h>
+#include <static_dag.h>
+#include <static_dag_builder.h>
+
+typedef enum {
+  STOP_NONE = 0,
+  STOP_CANCEL = 1,
+  STOP_THROW = 2
+} StopMode;
+
+
+// A chain 0 -> 1 -> ... -> N-1.  Node stop_key stops the run, so the
+// nodes after it must never run.
+class StaticChainNode final : public StaticNabbitNode {
+ public:
+  std::vector<int>* runs;
+  CancellationToken* token;
+  long long stop_key;
+  StopMode mode;
+
+  StaticChainNode()
+    : StaticNabbitNode(0), runs(NULL), token(NULL), stop_key(-1),
+      mode(STOP_NONE) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    (*runs)[this->key]++;
+    if (this->key == stop_key) {
+      if (mode == STOP_CANCEL) {
+        token->cancel();
+      }
+      else if (mode == STOP_THROW) {
+        throw std::runtime_error("bad input");
+      }
+    }
+  }
+};
+
+
+void static_cancel_test(long long N, StopMode mode,
+                        StaticNotifyPolicy policy) {
+  std::vector<int> runs(N, 0);
+  CancellationToken token;
+  std::vector<StaticChainNode> nodes(N);
+  std::vector<long long> src;
+  std::vector<long long> dst;
+  for (long long k = 0; k < N; k++) {
+    nodes[k].key = k;
+    nodes[k].runs = &runs;
+    nodes[k].token = &token;
+    nodes[k].stop_key = N / 2;
+    nodes[k].mode = mode;
+    if (k > 0) {
+      src.push_back(k - 1);
+      dst.push_back(k);
+    }
+  }
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(N);
+  builder.add_edges(src.data(), dst.data(), (long long)src.size());
+  builder.build_from_array(&dag, nodes.data());
+  dag.set_cancellation_token(&token);
+  dag.set_notify_policy(policy);
+
+  bool caught = false;
+  nabbit::execute([&]() {
+      try {
+        dag.execute_all();
+      }
+      catch (std::runtime_error& e) {
+        caught = true;
+      }
+    });
+  assert(caught == (mode == STOP_THROW));
+  assert(token.is_cancelled());
+  for (long long k = 0; k < N; k++) {
+    assert(runs[k] == ((k <= N / 2) ? 1 : 0));
+  }
+
+  // Reset, and run to the end without stopping.
+  token.reset();
+  dag.reset();
+  for (long long k = 0; k < N; k++) {
+    runs[k] = 0;
+    nodes[k].mode = STOP_NONE;
+  }
+  nabbit::execute([&]() { dag.execute_all(); });
+  for (long long k = 0; k < N; k++) {
+    assert(runs[k] == 1);
+  }
+  std::cout << "Static cancel test passed, N = " << N
+            << ", mode = " << mode << ", policy = " << policy << "\n";
+}
+
+
+// A W x W grid as in dynamic_fanout_test, where node stop_key stops
+// the run.  Its descendants, including the sink, must never run.
+class DynamicGridNode final : public DynamicNabbitNode {
+ public:
+  int W;
+  long long stop_key;
+  StopMode mode;
+  volatile int ran;
+
+  DynamicGridNode(long long k, TaskGraphHashTable* H, int W_,
+                  long long stop_key_, StopMode mode_)
+    : DynamicNabbitNode(k, H), W(W_), stop_key(stop_key_), mode(mode_),
+      ran(0) { }
+
+ protected:
+  void Init() {
+    if (this->key / W > 0) {
+      this->add_dep(this->key - W);
+    }
+    if (this->key % W > 0) {
+      this->add_dep(this->key - 1);
+    }
+  }
+
+  void Compute() {
+    this->ran = 1;
+    if (this->key == stop_key) {
+      if (mode == STOP_CANCEL) {
+        H->get_cancellation_token()->cancel();
+      }
+      else if (mode == STOP_THROW) {
+        throw std::runtime_error("bad input");
+      }
+    }
+  }
+
+  void Generate() { }
+};
+
+
+class DynamicGridTable : public TaskGraphHashTable {
+ public:
+  ConcurrentHashTable table;
+  int W;
+  long long stop_key;
+  StopMode mode;
+
+  DynamicGridTable(int W_, long long stop_key_, StopMode mode_)
+    : table(1024), W(W_), stop_key(stop_key_), mode(mode_) { }
+
+  ~DynamicGridTable() {
+    for (long long k = 0; k < (long long)W * W; k++) {
+      delete (DynamicGridNode*)get_task(k);
+    }
+  }
+
+  void* get_task(long long key) {
+    LOpStatus code;
+    return table.search(key, &code);
+  }
+
+  int insert_task_if_absent(long long key) {
+    DynamicGridNode* n = new DynamicGridNode(key, this, W, stop_key, mode);
+    n->try_mark_as_visited();
+    LOpStatus code = OP_FAILED;
+    table.insert_if_absent(key, n, &code);
+    if (code != OP_INSERTED) {
+      delete n;
+      return 0;
+    }
+    return 1;
+  }
+};
+
+
+void dynamic_cancel_test(int W, StopMode mode) {
+  long long sink = (long long)W * W - 1;
+  long long stop_key = (W / 2) * W + (W / 2);
+  CancellationToken token;
+  DynamicGridTable H(W, stop_key, mode);
+  H.set_cancellation_token(&token);
+  DynamicGridNode root(-1, &H, W, stop_key, mode);
+
+  bool caught = false;
+  nabbit::execute([&]() {
+      try {
+        root.init_root_and_compute(sink);
+      }
+      catch (std::runtime_error& e) {
+        caught = true;
+      }
+    });
+  assert(caught == (mode == STOP_THROW));
+  assert(token.is_cancelled());
+
+  DynamicGridNode* stop = (DynamicGridNode*)H.get_task(stop_key);
+  assert((stop != NULL) && stop->ran);
+  for (long long k = 0; k <= sink; k++) {
+    DynamicGridNode* n = (DynamicGridNode*)H.get_task(k);
+    if ((k / W >= stop_key / W) && (k % W >= stop_key % W) && (k != stop_key)) {
+      assert((n == NULL) || !n->ran);
+    }
+  }
+  std::cout << "Dynamic cancel test passed, W = " << W
+            << ", mode = " << mode << "\n";
+}
+
+
+// Throws from a spawn whose scope only syncs implicitly, on exit.
+// The exception must still reach the caller.
+void throw_in_scope(int depth) {
+  NABBIT_SPAWN_SCOPE;
+  if (depth == 0) {
+    throw std::runtime_error("bad input");
+  }
+  NABBIT_SPAWN(throw_in_scope(depth - 1));
+}
+
+void implicit_sync_throw_test() {
+  bool caught = false;
+  nabbit::execute([&]() {
+      try {
+        throw_in_scope(3);
+      }
+      catch (std::runtime_error& e) {
+        caught = true;
+      }
+    });
+  assert(caught);
+  std::cout << "Implicit sync throw test passed\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  long long N = 10000;
+  if (argc >= 2) {
+    N = atoll(argv[1]);
+  }
+  // With NOTIFY_SPAWN_ALL, each node of a chain spawns its successor
+  // and syncs on it.  Executors that run a task they wait for on the
+  // waiting thread's stack (oneTBB, OpenMP) then nest one spawn per
+  // node, so a long chain can overflow a worker's stack.  Chains up
+  // to SPAWN_ALL_SAFE_DEPTH nodes are well within the default stack
+  // sizes.  NOTIFY_CONTINUE_LAST runs a chain as a loop, at any depth.
+  const long long SPAWN_ALL_SAFE_DEPTH = 1000;
+  long long spawn_all_N = (N < SPAWN_ALL_SAFE_DEPTH) ? N : SPAWN_ALL_SAFE_DEPTH;
+  static_cancel_test(spawn_all_N, STOP_CANCEL, NOTIFY_SPAWN_ALL);
+  static_cancel_test(spawn_all_N, STOP_THROW, NOTIFY_SPAWN_ALL);
+  static_cancel_test(N, STOP_CANCEL, NOTIFY_CONTINUE_LAST);
+  static_cancel_test(N, STOP_THROW, NOTIFY_CONTINUE_LAST);
+  dynamic_cancel_test(64, STOP_CANCEL);
+  dynamic_cancel_test(64, STOP_THROW);
+  implicit_sync_throw_test();
+  return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * coarsen_test.cpp
+ *
+ * Coarsens static Nabbit DAGs of tiny nodes into clusters, and checks
+ * that running the clusters computes every node, in a valid order.
+ *
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+#include <static_reduction_node.h>
+
+const long long COARSEN_MOD = 1000000007LL;
+
+
+// Each node in a chain checks that its predecessor has already been
+// computed, and records its own position.
+class ChainNode final : public StaticNabbitNode {
+ public:
+  long long* order;
+  long long* counter;
+
+  ChainNode(long long k, long long* order_, long long* counter_)
+    : StaticNabbitNode(k), order(order_), counter(counter_) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    if (this->key > 0) {
+      assert(order[this->key - 1] >= 0);
+    }
+    order[this->key] = (*counter)++;
+  }
+};
+
+
+// A chain of N nodes falls into runs of grain nodes.
+void chain_test(long long N, long long grain) {
+  std::vector<long long> order(N, -1);
+  long long counter = 0;
+
+  StaticDAG<StaticNabbitNode> dag;
+  for (long long i = 0; i < N; i++) {
+    ChainNode* n = new ChainNode(i, &order[0], &counter);
+    n->init_node(1);
+    if (i > 0) {
+      n->add_dep(dag.get_node(i - 1));
+    }
+    dag.add_node(n);
+  }
+  dag.freeze();
+  // Clusters take the policy of their first member, so with grain 1
+  // the chain of clusters does not nest a spawn per cluster.
+  dag.set_notify_policy(NOTIFY_CONTINUE_LAST);
+  dag.coarsen(NULL, grain);
+  assert(dag.num_clusters() == (N + grain - 1) / grain);
+
+  for (int rep = 0; rep < 2; rep++) {
+    counter = 0;
+    for (long long i = 0; i < N; i++) {
+      order[i] = -1;
+    }
+    nabbit::execute([&]() { dag.execute_all(); });
+    assert(counter == N);
+    for (long long i = 0; i < N; i++) {
+      assert(order[i] == i);
+    }
+    dag.reset();
+  }
+
+  for (long long i = 0; i < N; i++) {
+    delete (ChainNode*)dag.get_node(i);
+  }
+  std::cout << "Coarsened chain test passed, N = " << N
+            << ", grain = " << grain << "\n";
+}
+
+
+struct SumCombine {
+  long long operator()(const long long& a, const long long& b) const {
+    return a + b;
+  }
+};
+
+// Node (i, j) of a grid sums its predecessors (i-1, j) and (i, j-1),
+// through StaticReductionNode, which folds them in just before
+// Compute() when the node is in a cluster.
+class GridNode final : public StaticReductionNode<long long, SumCombine> {
+ public:
+  long long value;
+
+  GridNode(long long k)
+    : StaticReductionNode<long long, SumCombine>(k, 0), value(-1) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    value = (this->merge_partials() + 1) % COARSEN_MOD;
+  }
+  long long Contribution(StaticNabbitNode* pred) {
+    assert(((GridNode*)pred)->value >= 0);
+    return ((GridNode*)pred)->value;
+  }
+};
+
+
+void grid_test(int W, long long grain) {
+  long long V = (long long)W * W;
+  StaticDAG<StaticNabbitNode> dag;
+  for (long long k = 0; k < V; k++) {
+    GridNode* n = new GridNode(k);
+    n->init_node(2);
+    if (k / W > 0) {
+      n->add_dep(dag.get_node(k - W));
+    }
+    if (k % W > 0) {
+      n->add_dep(dag.get_node(k - 1));
+    }
+    dag.add_node(n);
+  }
+  dag.freeze();
+
+  // Node (i, j) costs j + 1, so clusters hold fewer nodes to the right.
+  std::vector<long long> costs(V);
+  std::vector<long long> expected(V);
+  long long total_cost = 0;
+  for (long long k = 0; k < V; k++) {
+    costs[k] = k % W + 1;
+    total_cost += costs[k];
+    long long v = 1;
+    if (k / W > 0) { v += expected[k - W]; }
+    if (k % W > 0) { v += expected[k - 1]; }
+    expected[k] = v % COARSEN_MOD;
+  }
+  dag.coarsen(costs.data(), grain);
+
+  // A cluster costs at most grain, unless it is a single node.
+  long long max_cost = std::max(grain, (long long)W);
+  assert(dag.num_clusters() >= (total_cost + max_cost - 1) / max_cost);
+  assert(dag.num_clusters() <= V);
+  if (grain == 1) {
+    assert(dag.num_clusters() == V);
+  }
+
+  for (int rep = 0; rep < 3; rep++) {
+    // The last run goes node by node again.
+    if (rep == 2) {
+      dag.uncoarsen();
+      assert(dag.num_clusters() == 0);
+    }
+    for (long long k = 0; k < V; k++) {
+      ((GridNode*)dag.get_node(k))->value = -1;
+    }
+    nabbit::execute([&]() { dag.execute_all(); });
+    for (long long k = 0; k < V; k++) {
+      assert(((GridNode*)dag.get_node(k))->value == expected[k]);
+    }
+    dag.reset();
+  }
+
+  for (long long k = 0; k < V; k++) {
+    delete (GridNode*)dag.get_node(k);
+  }
+  std::cout << "Coarsened grid test passed, W = " << W
+            << ", grain = " << grain
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 128;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  chain_test(100000, 1);
+  chain_test(100000, 64);
+  chain_test(1000, 5000);
+  grid_test(W, 1);
+  grid_test(W, 256);
+  grid_test(W, 1LL << 40);
+  return 0;
+}
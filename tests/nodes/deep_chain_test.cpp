@@ -0,0 +1,200 @@
+/*
+ * deep_chain_test.cpp
+ *
+ * Runs long chains through the serial engines (and the parallel
+ * engines, where they are serialized or loop over a chain), to check
+ * that the depth of a DAG is not limited by the size of the call
+ * stack.
+ *
+ */
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+#include <static_serial_node.h>
+#include <dynamic_serial_node.h>
+#include <dynamic_nabbit_node.h>
+
+
+// Each node in a chain checks that its predecessor has already been
+// computed, and records its own position.
+template <class BaseNode>
+class ChainNode final : public BaseNode {
+ public:
+  long long* order;
+  long long* counter;
+
+  ChainNode(long long k, long long* order_, long long* counter_)
+    : BaseNode(k), order(order_), counter(counter_) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    if (this->key > 0) {
+      assert(order[this->key - 1] >= 0);
+    }
+    order[this->key] = (*counter)++;
+  }
+};
+
+
+// Only the parallel static engine has notify policies.
+void set_chain_policy(StaticDAG<StaticSerialNode>& dag,
+                      bool continue_last) {
+  assert(!continue_last);
+}
+
+void set_chain_policy(StaticDAG<StaticNabbitNode>& dag,
+                      bool continue_last) {
+  if (continue_last) {
+    dag.set_notify_policy(NOTIFY_CONTINUE_LAST);
+  }
+}
+
+
+// Builds a chain 0 -> 1 -> ... -> N-1, runs it from node 0, and
+// checks that every node was computed in order.
+template <class BaseNode>
+void static_chain_test(const char* name, long long N, bool continue_last) {
+  std::vector<long long> order(N, -1);
+  long long counter = 0;
+
+  StaticDAG<BaseNode> dag;
+  for (long long i = 0; i < N; i++) {
+    ChainNode<BaseNode>* n = new ChainNode<BaseNode>(i, &order[0], &counter);
+    n->init_node(1);
+    if (i > 0) {
+      n->add_dep(dag.get_node(i - 1));
+    }
+    dag.add_node(n);
+  }
+  dag.freeze();
+  set_chain_policy(dag, continue_last);
+
+  for (int rep = 0; rep < 2; rep++) {
+    counter = 0;
+    for (long long i = 0; i < N; i++) {
+      order[i] = -1;
+    }
+    nabbit::execute([&]() { dag.get_node(0)->source_compute(); });
+    assert(counter == N);
+    for (long long i = 0; i < N; i++) {
+      assert(order[i] == i);
+    }
+    dag.reset();
+  }
+
+  for (long long i = 0; i < N; i++) {
+    delete (ChainNode<BaseNode>*)dag.get_node(i);
+  }
+  std::cout << name << " chain test passed, N = " << N << "\n";
+}
+
+
+template <class BaseNode>
+class DynamicChainNode final : public BaseNode {
+ public:
+  long long* order;
+  long long* counter;
+
+  DynamicChainNode(long long k, TaskGraphHashTable* H,
+                   long long* order_, long long* counter_)
+    : BaseNode(k, H), order(order_), counter(counter_) { }
+
+ protected:
+  void Init() {
+    if (this->key > 0) {
+      this->add_dep(this->key - 1);
+    }
+  }
+  void Compute() {
+    if (this->key > 0) {
+      assert(order[this->key - 1] >= 0);
+    }
+    order[this->key] = (*counter)++;
+  }
+  void Generate() { }
+};
+
+
+// A hash table that creates (and visits) a DynamicChainNode the first
+// time a key is inserted.
+template <class BaseNode>
+class ChainHashTable : public TaskGraphHashTable {
+ public:
+  std::unordered_map<long long, DynamicChainNode<BaseNode>*> tasks;
+  long long* order;
+  long long* counter;
+
+  ChainHashTable(long long* order_, long long* counter_)
+    : order(order_), counter(counter_) { }
+
+  ~ChainHashTable() {
+    for (auto& kv : tasks) {
+      delete kv.second;
+    }
+  }
+
+  void* get_task(long long key) {
+    auto it = tasks.find(key);
+    return (it == tasks.end()) ? NULL : it->second;
+  }
+
+  int insert_task_if_absent(long long key) {
+    if (tasks.count(key)) {
+      return 0;
+    }
+    DynamicChainNode<BaseNode>* n =
+      new DynamicChainNode<BaseNode>(key, this, order, counter);
+    n->try_mark_as_visited();
+    tasks[key] = n;
+    return 1;
+  }
+};
+
+
+// Expands the chain backwards from its last node, then computes it
+// forwards.  Both directions are N deep.
+template <class BaseNode>
+void dynamic_chain_test(const char* name, long long N) {
+  std::vector<long long> order(N, -1);
+  long long counter = 0;
+  ChainHashTable<BaseNode> H(&order[0], &counter);
+
+  // Only used to start the traversal; never inserted into H.
+  DynamicChainNode<BaseNode> root(-1, &H, &order[0], &counter);
+  bool inserted = root.init_root_and_compute(N - 1);
+  assert(inserted);
+  assert(counter == N);
+  for (long long i = 0; i < N; i++) {
+    assert(order[i] == i);
+    assert(((DynamicChainNode<BaseNode>*)H.get_task(i))->get_status() == NODE_COMPLETED);
+  }
+  std::cout << name << " chain test passed, N = " << N << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  long long N = 1000000;
+  if (argc >= 2) {
+    N = atoll(argv[1]);
+  }
+
+  static_chain_test<StaticSerialNode>("StaticSerialNode", N, false);
+  dynamic_chain_test<DynamicSerialNode>("DynamicSerialNode", N);
+
+  // With NOTIFY_CONTINUE_LAST, a chain is a loop in any build.  In a
+  // serialized build, the default policy should not recurse either.
+  static_chain_test<StaticNabbitNode>("StaticNabbitNode (continue last)", N, true);
+#if defined(NABBIT_SERIALIZE)
+  static_chain_test<StaticNabbitNode>("StaticNabbitNode (serialized)", N, false);
+  dynamic_chain_test<DynamicNabbitNode>("DynamicNabbitNode (serialized)", N);
+#endif
+  return 0;
+}
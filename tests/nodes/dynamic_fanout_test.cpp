@@ -0,0 +1,146 @@
+/*
+ * dynamic_fanout_test.cpp
+ *
+ * Runs a DynamicNabbitNode DAG in which every node also waits on a
+ * single shared node, so that many workers register as successors of
+ * the same node at once.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <concurrent_hash_table.h>
+#include <dynamic_nabbit_node.h>
+
+const long long FANOUT_MOD = 1000000007LL;
+
+
+// A W x W grid, where node (i, j) depends on (i-1, j), (i, j-1), and
+// on the hub node (0, 0).  Its value is the sum of the values of its
+// grid neighbors, i.e., the number of monotone paths to it.
+class GridNode final : public DynamicNabbitNode {
+ public:
+  int W;
+  long long value;
+
+  GridNode(long long k, TaskGraphHashTable* H, int W_)
+    : DynamicNabbitNode(k, H), W(W_), value(0) { }
+
+ protected:
+  void Init() {
+    long long i = this->key / W;
+    long long j = this->key % W;
+    if (i > 0) {
+      this->add_dep(this->key - W);
+    }
+    if (j > 0) {
+      this->add_dep(this->key - 1);
+    }
+    if ((this->key != 0) && (this->key != 1) && (this->key != W)) {
+      this->add_dep(0);
+    }
+  }
+
+  void Compute() {
+    long long i = this->key / W;
+    long long j = this->key % W;
+    if (this->key == 0) {
+      this->value = 1;
+      return;
+    }
+    assert(((GridNode*)H->get_task(0))->value == 1);
+    long long v = 0;
+    if (i > 0) {
+      v += ((GridNode*)H->get_task(this->key - W))->value;
+    }
+    if (j > 0) {
+      v += ((GridNode*)H->get_task(this->key - 1))->value;
+    }
+    this->value = v % FANOUT_MOD;
+  }
+
+  void Generate() { }
+};
+
+
+class GridHashTable : public TaskGraphHashTable {
+ public:
+  ConcurrentHashTable table;
+  int W;
+
+  GridHashTable(int W_) : table(1024), W(W_) { }
+
+  ~GridHashTable() {
+    for (long long k = 0; k < (long long)W * W; k++) {
+      delete (GridNode*)get_task(k);
+    }
+  }
+
+  void* get_task(long long key) {
+    LOpStatus code;
+    return table.search(key, &code);
+  }
+
+  // Nodes are visited before they are published.
+  int insert_task_if_absent(long long key) {
+    GridNode* n = new GridNode(key, this, W);
+    n->try_mark_as_visited();
+    LOpStatus code = OP_FAILED;
+    table.insert_if_absent(key, n, &code);
+    if (code != OP_INSERTED) {
+      delete n;
+      return 0;
+    }
+    return 1;
+  }
+};
+
+
+void fanout_test(int W) {
+  GridHashTable H(W);
+  GridNode root(-1, &H, W);
+  long long sink = (long long)W * W - 1;
+  nabbit::execute([&]() {
+      bool inserted = root.init_root_and_compute(sink);
+      assert(inserted);
+    });
+
+  // Check against a serial computation of the same grid.
+  std::vector<long long> expected((long long)W * W, 0);
+  for (long long k = 0; k <= sink; k++) {
+    GridNode* n = (GridNode*)H.get_task(k);
+    assert(n != NULL);
+    assert(n->get_status() == NODE_COMPLETED);
+    long long i = k / W;
+    long long j = k % W;
+    if (k == 0) {
+      expected[k] = 1;
+    }
+    else {
+      long long v = 0;
+      if (i > 0) { v += expected[k - W]; }
+      if (j > 0) { v += expected[k - 1]; }
+      expected[k] = v % FANOUT_MOD;
+    }
+    assert(n->value == expected[k]);
+  }
+  std::cout << "Dynamic fan-out test passed, W = " << W
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 64;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  for (int rep = 0; rep < 3; rep++) {
+    fanout_test(W);
+  }
+  return 0;
+}
@@ -0,0 +1,255 @@
+/*
+ * fan_in_test.cpp
+ *
+ * Runs static Nabbit DAGs whose sink has many predecessors, with and
+ * without a CombiningJoinCounter, and as a StaticReductionNode, which
+ * must start clean after a cancelled or throwing run.
+ *
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <combining_join_counter.h>
+#include <static_dag.h>
+#include <static_dag_builder.h>
+#include <static_reduction_node.h>
+
+
+// Node 0 is the source, nodes 1 .. F are in the middle, and node F+1
+// is the sink.  The sink checks that every middle node ran first.
+class FanInNode final : public StaticNabbitNode {
+ public:
+  int F;
+  std::vector<int>* done;
+  long long sink_runs;
+
+  FanInNode() : StaticNabbitNode(0), F(0), done(NULL), sink_runs(0) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    if (this->key == F + 1) {
+      for (int i = 1; i <= F; i++) {
+        assert((*done)[i] == 1);
+      }
+      sink_runs++;
+    }
+    else {
+      (*done)[this->key] = 1;
+    }
+  }
+};
+
+
+void fan_in_test(int F, int threshold) {
+  int saved_threshold = nabbit::combining_join_threshold();
+  nabbit::set_combining_join_threshold(threshold);
+
+  std::vector<int> done(F + 2, 0);
+  std::vector<FanInNode> nodes(F + 2);
+  for (int i = 0; i < F + 2; i++) {
+    nodes[i].key = i;
+    nodes[i].F = F;
+    nodes[i].done = &done;
+  }
+
+  std::vector<long long> src;
+  std::vector<long long> dst;
+  for (int i = 1; i <= F; i++) {
+    src.push_back(0);
+    dst.push_back(i);
+    src.push_back(i);
+    dst.push_back(F + 1);
+  }
+
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(F + 2);
+  builder.add_edges(src.data(), dst.data(), (long long)src.size());
+  builder.build_from_array(&dag, nodes.data());
+  nabbit::set_combining_join_threshold(saved_threshold);
+
+  FanInNode* sink = &nodes[F + 1];
+  assert(sink->has_combining_join() == (F > threshold));
+  assert(!nodes[1].has_combining_join());
+
+  for (int rep = 0; rep < 3; rep++) {
+    for (int i = 1; i <= F; i++) {
+      done[i] = 0;
+    }
+    nabbit::execute([&]() { nodes[0].source_compute(); });
+    assert(sink->sink_runs == rep + 1);
+    dag.reset();
+  }
+  std::cout << "Fan-in test passed, F = " << F
+            << ", combining = " << sink->has_combining_join() << "\n";
+}
+
+
+struct SumCombine {
+  long long operator()(const long long& a, const long long& b) const {
+    return a + b;
+  }
+};
+
+// The same shape, where the sink sums the keys of the middle nodes as
+// they finish.  A node may also cancel the token, or throw, after
+// computing its sum.
+class SumNode final : public StaticReductionNode<long long, SumCombine> {
+ public:
+  long long sum;
+  CancellationToken* cancels;
+  bool throws;
+
+  SumNode()
+    : StaticReductionNode<long long, SumCombine>(0, 0),
+      sum(0), cancels(NULL), throws(false) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    sum = this->merge_partials() + this->key;
+    if (cancels != NULL) {
+      cancels->cancel();
+    }
+    if (throws) {
+      throw std::runtime_error("fan_in");
+    }
+  }
+  long long Contribution(StaticNabbitNode* pred) {
+    return ((SumNode*)pred)->sum;
+  }
+};
+
+
+void reduction_test(int F, int threshold) {
+  int saved_threshold = nabbit::combining_join_threshold();
+  nabbit::set_combining_join_threshold(threshold);
+
+  std::vector<SumNode> nodes(F + 2);
+  std::vector<long long> src;
+  std::vector<long long> dst;
+  for (int i = 0; i < F + 2; i++) {
+    nodes[i].key = i;
+  }
+  for (int i = 1; i <= F; i++) {
+    src.push_back(0);
+    dst.push_back(i);
+    src.push_back(i);
+    dst.push_back(F + 1);
+  }
+
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(F + 2);
+  builder.add_edges(src.data(), dst.data(), (long long)src.size());
+  builder.build_from_array(&dag, nodes.data());
+  nabbit::set_combining_join_threshold(saved_threshold);
+
+  // Middle node i computes i, since the source has key 0.
+  long long expected = (long long)F * (F + 1) / 2 + (F + 1);
+  for (int rep = 0; rep < 3; rep++) {
+    nabbit::execute([&]() { nodes[0].source_compute(); });
+    assert(nodes[F + 1].sum == expected);
+    dag.reset();
+  }
+  std::cout << "Reduction test passed, F = " << F
+            << ", combining = " << nodes[F + 1].has_combining_join() << "\n";
+}
+
+
+// The chain 0 -> 1 -> 2, with edges 1 -> 3 and 2 -> 3, where node 2
+// cancels the run, or throws.  Either way node 1 (and, if it cancels,
+// node 2) folds into the sink, which never computes.  After a reset,
+// a clean run must not see those folds.
+void reduction_failure_test(bool throws) {
+  std::vector<SumNode> nodes(4);
+  for (int i = 0; i < 4; i++) {
+    nodes[i].key = i;
+  }
+  long long src[] = { 0, 1, 1, 2 };
+  long long dst[] = { 1, 2, 3, 3 };
+
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(4);
+  builder.add_edges(src, dst, 4);
+  builder.build_from_array(&dag, nodes.data());
+  CancellationToken tok;
+  dag.set_cancellation_token(&tok);
+
+  nodes[3].sum = -1;
+  if (throws) {
+    nodes[2].throws = true;
+  }
+  else {
+    nodes[2].cancels = &tok;
+  }
+  bool caught = false;
+  try {
+    nabbit::execute([&]() { dag.execute_all(); });
+  }
+  catch (std::runtime_error& e) {
+    caught = true;
+  }
+  assert(caught == throws);
+  assert(nodes[3].sum == -1);
+
+  nodes[2].throws = false;
+  nodes[2].cancels = NULL;
+  tok.reset();
+  dag.reset();
+  for (int rep = 0; rep < 2; rep++) {
+    nabbit::execute([&]() { dag.execute_all(); });
+    // 0, then 0 + 1, then 1 + 2, then 1 + 3 + 3.
+    assert(nodes[3].sum == 7);
+    dag.reset();
+  }
+  std::cout << "Reduction " << (throws ? "throw" : "cancel")
+            << " test passed\n";
+}
+
+
+// Drives a CombiningJoinCounter directly.
+void counter_test(int n) {
+  std::vector<int> slots(n);
+  std::vector<int*> preds(n);
+  for (int i = 0; i < n; i++) {
+    preds[i] = &slots[i];
+  }
+  CombiningJoinCounter c(preds.data(), n);
+  for (int rep = 0; rep < 2; rep++) {
+    for (int i = 0; i < n; i++) {
+      bool last = c.arrive(preds[i]);
+      assert(last == (i == n - 1));
+    }
+    c.reset();
+  }
+  std::cout << "Counter test passed, n = " << n
+            << ", leaves = " << c.num_leaves() << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int F = 100000;
+  if (argc >= 2) {
+    F = atoi(argv[1]);
+  }
+
+  counter_test(1);
+  counter_test(nabbit::COMBINING_JOIN_ARITY + 1);
+  counter_test(F);
+
+  fan_in_test(F, 1024);
+  fan_in_test(F, F);
+  fan_in_test(100, 8);
+
+  reduction_test(F, 1024);
+  reduction_test(F, F);
+  reduction_failure_test(false);
+  reduction_failure_test(true);
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * levels_test.cpp
+ *
+ * Sorts static Nabbit DAGs into topological levels with
+ * StaticDAG::compute_levels(), and checks that execute_levels()
+ * computes every node after its predecessors.
+ *
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+
+const long long LEVELS_MOD = 1000000007LL;
+
+
+// Each node adds up the values of its predecessors, plus 1, and
+// checks that they have all been computed.
+class SumNode final : public StaticNabbitNode {
+ public:
+  long long value;
+
+  SumNode(long long k) : StaticNabbitNode(k), value(-1) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    long long v = 1;
+    for (int i = 0; i < this->num_predecessors(); i++) {
+      SumNode* pred = (SumNode*)this->predecessor(i);
+      assert(pred->value >= 0);
+      v += pred->value;
+    }
+    value = v % LEVELS_MOD;
+  }
+};
+
+
+// Runs the DAG a few times with execute_levels(), checking each value
+// against expected, which lists the nodes' values in the order they
+// were registered.
+void run_levels(StaticDAG<StaticNabbitNode>* dag,
+                const std::vector<long long>& expected) {
+  for (int rep = 0; rep < 3; rep++) {
+    for (long long k = 0; k < dag->num_nodes(); k++) {
+      ((SumNode*)dag->get_node(k))->value = -1;
+    }
+    nabbit::execute([&]() { dag->execute_levels(); });
+    for (long long k = 0; k < dag->num_nodes(); k++) {
+      assert(((SumNode*)dag->get_node(k))->value == expected[k]);
+    }
+    dag->reset();
+  }
+  for (long long k = 0; k < dag->num_nodes(); k++) {
+    delete (SumNode*)dag->get_node(k);
+  }
+}
+
+
+// Node (i, j) of an H x W grid depends on (i-1, j) and (i, j-1), so
+// it is on level i + j.
+void grid_test(long long H, long long W) {
+  StaticDAG<StaticNabbitNode> dag;
+  std::vector<long long> expected(H * W);
+  for (long long k = 0; k < H * W; k++) {
+    SumNode* n = new SumNode(k);
+    n->init_node(2);
+    long long v = 1;
+    if (k / W > 0) {
+      n->add_dep(dag.get_node(k - W));
+      v += expected[k - W];
+    }
+    if (k % W > 0) {
+      n->add_dep(dag.get_node(k - 1));
+      v += expected[k - 1];
+    }
+    expected[k] = v % LEVELS_MOD;
+    dag.add_node(n);
+  }
+  dag.freeze();
+  assert(dag.num_levels() == 0);
+  dag.compute_levels();
+  assert(dag.num_levels() == H + W - 1);
+
+  run_levels(&dag, expected);
+  std::cout << "Levels grid test passed, " << H << " x " << W
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+// A random DAG of V nodes, each with up to D edges from earlier
+// nodes, so some nodes are sources and some have no successors.
+void random_test(long long V, int D, unsigned seed) {
+  srand(seed);
+  StaticDAG<StaticNabbitNode> dag;
+  std::vector<long long> expected(V);
+  std::vector<long long> depth(V, 0);
+  long long max_depth = 0;
+  for (long long k = 0; k < V; k++) {
+    SumNode* n = new SumNode(k);
+    n->init_node(D);
+    long long v = 1;
+    int d = (k > 0) ? rand() % (D + 1) : 0;
+    for (int e = 0; e < d; e++) {
+      long long p = rand() % k;
+      n->add_dep(dag.get_node(p));
+      v += expected[p];
+      depth[k] = std::max(depth[k], depth[p] + 1);
+    }
+    expected[k] = v % LEVELS_MOD;
+    max_depth = std::max(max_depth, depth[k]);
+    dag.add_node(n);
+  }
+  dag.freeze();
+  dag.compute_levels();
+  assert(dag.num_levels() == max_depth + 1);
+
+  run_levels(&dag, expected);
+  std::cout << "Levels random test passed, V = " << V << ", D = " << D
+            << ", levels = " << max_depth + 1
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 128;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  grid_test(W, W);
+  grid_test(10000, 1);
+  grid_test(1, 10000);
+  random_test(20000, 4, 1);
+  random_test(20000, 1, 2);
+  return 0;
+}
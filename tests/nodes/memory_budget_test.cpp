@@ -0,0 +1,118 @@
+/*
+ * memory_budget_test.cpp
+ *
+ * Runs wide fork/join DAGs of static Nabbit nodes under a
+ * MemoryBudget, and checks that the nodes running at once never
+ * exceed it.
+ *
+ */
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <memory_budget.h>
+#include <static_dag.h>
+#include <static_dag_builder.h>
+
+
+// Tracks the estimates of the nodes inside Compute().
+struct Usage {
+  std::atomic<long long> current;
+  std::atomic<long long> peak;
+  std::atomic<long long> runs;
+};
+
+
+// Node 0 is the source, nodes 1 .. F are in the middle, and node F+1
+// is the sink.  Each middle node allocates and touches a buffer of its
+// estimated size.
+class WideNode final : public StaticNabbitNode {
+ public:
+  Usage* usage;
+
+  WideNode() : StaticNabbitNode(0), usage(NULL) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    long long bytes = this->get_memory_estimate();
+    long long now = (usage->current += bytes);
+    long long p = usage->peak.load();
+    while ((now > p) && !usage->peak.compare_exchange_weak(p, now)) {
+    }
+
+    std::vector<char> buffer(bytes);
+    for (long long i = 0; i < bytes; i += 4096) {
+      buffer[i] = (char)i;
+    }
+    usage->runs++;
+    usage->current -= bytes;
+  }
+};
+
+
+void memory_budget_test(int F, long long node_bytes, long long limit) {
+  Usage usage;
+  usage.current = 0;
+  usage.peak = 0;
+  usage.runs = 0;
+
+  std::vector<WideNode> nodes(F + 2);
+  std::vector<long long> src;
+  std::vector<long long> dst;
+  for (int i = 0; i < F + 2; i++) {
+    nodes[i].key = i;
+    nodes[i].usage = &usage;
+    if ((i >= 1) && (i <= F)) {
+      nodes[i].set_memory_estimate(node_bytes);
+    }
+  }
+  for (int i = 1; i <= F; i++) {
+    src.push_back(0);
+    dst.push_back(i);
+    src.push_back(i);
+    dst.push_back(F + 1);
+  }
+
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(F + 2);
+  builder.add_edges(src.data(), dst.data(), (long long)src.size());
+  builder.build_from_array(&dag, nodes.data());
+
+  MemoryBudget budget(limit);
+  dag.set_memory_budget(&budget);
+  for (int rep = 0; rep < 2; rep++) {
+    usage.runs = 0;
+    nabbit::execute([&]() { dag.execute_all(); });
+    assert(usage.runs == F + 2);
+    assert(budget.get_in_use() == 0);
+    dag.reset();
+  }
+
+  // A node bigger than the budget runs alone.
+  long long allowed = (node_bytes > limit) ? node_bytes : limit;
+  assert(budget.get_peak() <= allowed);
+  assert(usage.peak.load() <= allowed);
+  std::cout << "Memory budget test passed, F = " << F
+            << ", limit = " << limit / node_bytes << " nodes"
+            << ", peak = " << usage.peak.load() / node_bytes << " nodes"
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int F = 20000;
+  if (argc >= 2) {
+    F = atoi(argv[1]);
+  }
+  const long long MB = 1 << 20;
+  memory_budget_test(F, MB, 2 * MB);
+  memory_budget_test(F, MB, 16 * MB);
+  memory_budget_test(100, 4 * MB, MB);
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * multi_source_test.cpp
+ *
+ * Runs StaticDAG::execute_all() on DAGs with many sources, for both
+ * static engines.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+#include <static_dag_builder.h>
+#include <static_serial_node.h>
+
+
+// S independent chains of length L, whose last nodes all feed one
+// sink.  Node (c, l) has key c*L + l, and the sink has key S*L.  Each
+// node counts how many times it ran, and checks its predecessors.
+template <class BaseNode>
+class MultiSourceNode final : public BaseNode {
+ public:
+  std::vector<int>* runs;
+
+  MultiSourceNode() : BaseNode(0), runs(NULL) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    for (int j = 0; j < this->num_predecessors(); j++) {
+      MultiSourceNode* pred = (MultiSourceNode*)this->predecessor(j);
+      assert((*runs)[pred->key] == 1);
+    }
+    (*runs)[this->key]++;
+  }
+};
+
+
+template <class BaseNode>
+void multi_source_test(const char* name, int S, int L, bool use_builder) {
+  long long V = (long long)S * L + 1;
+  long long sink = V - 1;
+  std::vector<int> runs(V, 0);
+  std::vector<MultiSourceNode<BaseNode> > nodes(V);
+  for (long long k = 0; k < V; k++) {
+    nodes[k].key = k;
+    nodes[k].runs = &runs;
+  }
+
+  StaticDAG<BaseNode> dag;
+  if (use_builder) {
+    std::vector<long long> src;
+    std::vector<long long> dst;
+    for (long long k = 0; k < sink; k++) {
+      src.push_back(k);
+      dst.push_back(((k % L) == L - 1) ? sink : k + 1);
+    }
+    StaticDAGBuilder<BaseNode> builder(V);
+    builder.add_edges(src.data(), dst.data(), (long long)src.size());
+    builder.build_from_array(&dag, nodes.data());
+  }
+  else {
+    for (long long k = 0; k < V; k++) {
+      nodes[k].init_node(2);
+    }
+    for (long long k = 0; k < sink; k++) {
+      long long next = ((k % L) == L - 1) ? sink : k + 1;
+      nodes[next].add_dep(&nodes[k]);
+    }
+    for (long long k = 0; k < V; k++) {
+      dag.add_node(&nodes[k]);
+    }
+  }
+  assert(dag.num_sources() == S);
+
+  for (int rep = 0; rep < 2; rep++) {
+    for (long long k = 0; k < V; k++) {
+      runs[k] = 0;
+    }
+    nabbit::execute([&]() { dag.execute_all(); });
+    for (long long k = 0; k < V; k++) {
+      assert(runs[k] == 1);
+    }
+    dag.reset();
+  }
+  std::cout << name << " multi-source test passed, S = " << S
+            << ", L = " << L << ", builder = " << use_builder << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int S = 10000;
+  if (argc >= 2) {
+    S = atoi(argv[1]);
+  }
+
+  multi_source_test<StaticSerialNode>("StaticSerialNode", S, 3, true);
+  multi_source_test<StaticSerialNode>("StaticSerialNode", 5, 2, false);
+  multi_source_test<StaticNabbitNode>("StaticNabbitNode", S, 3, true);
+  multi_source_test<StaticNabbitNode>("StaticNabbitNode", 5, 2, false);
+  multi_source_test<StaticNabbitNode>("StaticNabbitNode", 1, 1, true);
+  return 0;
+}
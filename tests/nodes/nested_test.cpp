@@ -0,0 +1,170 @@
+/*
+ * nested_test.cpp
+ *
+ * Runs grids of static Nabbit nodes whose nodes run grids of their
+ * own with StaticDAG::execute_nested(), and checks that each node's
+ * successors only start once its nested grid is done.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+
+const long long NESTED_MOD = 1000000007LL;
+
+
+// Node (i, j) of a W x W grid adds up the results of (i-1, j) and
+// (i, j-1), plus 1, and a source of a nested grid adds its parent's
+// sum too.  A node at level 0 returns its sum.  A node at a higher
+// level runs a grid of level - 1 nodes on its sum, and returns the
+// result of that grid's sink.
+class NestNode final : public StaticNabbitNode {
+ public:
+  long long sum;
+  long long value;
+  NestNode* parent;
+  StaticDAG<StaticNabbitNode>* inner;
+
+  NestNode(long long k, NestNode* parent_)
+    : StaticNabbitNode(k), sum(-1), value(-1), parent(parent_), inner(NULL) { }
+
+  long long result() {
+    if (inner != NULL) {
+      return ((NestNode*)inner->get_node(inner->num_nodes() - 1))->result();
+    }
+    return value;
+  }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    long long s = 1;
+    if ((this->num_predecessors() == 0) && (parent != NULL)) {
+      assert(parent->sum >= 0);
+      s += parent->sum;
+    }
+    for (int i = 0; i < this->num_predecessors(); i++) {
+      long long r = ((NestNode*)this->predecessor(i))->result();
+      assert(r >= 0);
+      s += r;
+    }
+    sum = s % NESTED_MOD;
+    if (inner != NULL) {
+      inner->execute_nested(this);
+    }
+    else {
+      value = sum;
+    }
+  }
+};
+
+
+void build_grid(StaticDAG<StaticNabbitNode>* dag, int W, int level,
+                NestNode* parent) {
+  for (long long k = 0; k < (long long)W * W; k++) {
+    NestNode* n = new NestNode(k, parent);
+    n->init_node(2);
+    if (k / W > 0) {
+      n->add_dep(dag->get_node(k - W));
+    }
+    if (k % W > 0) {
+      n->add_dep(dag->get_node(k - 1));
+    }
+    if (level > 0) {
+      n->inner = new StaticDAG<StaticNabbitNode>();
+      build_grid(n->inner, W, level - 1, n);
+    }
+    dag->add_node(n);
+  }
+  dag->freeze();
+}
+
+// Clears the values, and resets the nested grids for another run.
+void reset_grid(StaticDAG<StaticNabbitNode>* dag) {
+  for (long long k = 0; k < dag->num_nodes(); k++) {
+    NestNode* n = (NestNode*)dag->get_node(k);
+    n->sum = -1;
+    n->value = -1;
+    if (n->inner != NULL) {
+      reset_grid(n->inner);
+    }
+  }
+  dag->reset();
+}
+
+void delete_grid(StaticDAG<StaticNabbitNode>* dag) {
+  for (long long k = 0; k < dag->num_nodes(); k++) {
+    NestNode* n = (NestNode*)dag->get_node(k);
+    if (n->inner != NULL) {
+      delete_grid(n->inner);
+      delete n->inner;
+    }
+    delete n;
+  }
+}
+
+// The result of a W x W grid at the given level, serially.
+long long expected_result(int W, int level, long long seed) {
+  std::vector<long long> r((long long)W * W);
+  for (long long k = 0; k < (long long)W * W; k++) {
+    long long s = 1 + ((k == 0) ? seed : 0);
+    if (k / W > 0) { s += r[k - W]; }
+    if (k % W > 0) { s += r[k - 1]; }
+    s %= NESTED_MOD;
+    r[k] = (level > 0) ? expected_result(W, level - 1, s) : s;
+  }
+  return r.back();
+}
+
+
+// Runs the grid three times: with execute_all(), with
+// execute_adaptive(), which may run it serially, and coarsened into
+// clusters.
+void nested_test(int W, int levels) {
+  StaticDAG<StaticNabbitNode> dag;
+  build_grid(&dag, W, levels, NULL);
+  long long expected = expected_result(W, levels, 0);
+
+  for (int rep = 0; rep < 3; rep++) {
+    if (rep == 1) {
+      dag.choose_traversal(NULL, 1, 0);
+    }
+    if (rep == 2) {
+      dag.coarsen(NULL, W);
+    }
+    nabbit::execute([&]() {
+        if (rep == 1) {
+          dag.execute_adaptive();
+        }
+        else {
+          dag.execute_all();
+        }
+      });
+    long long sink = dag.num_nodes() - 1;
+    assert(((NestNode*)dag.get_node(sink))->result() == expected);
+    reset_grid(&dag);
+  }
+  delete_grid(&dag);
+  std::cout << "Nested grid test passed, W = " << W
+            << ", levels = " << levels
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 16;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  nested_test(W, 0);
+  nested_test(W, 1);
+  nested_test(8, 2);
+  nested_test(1, 3);
+  return 0;
+}
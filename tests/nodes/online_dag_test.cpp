@@ -0,0 +1,114 @@
+/*
+ * online_dag_test.cpp
+ *
+ * Grows an OnlineDAG while it runs, and checks that every node runs
+ * once, after all of its predecessors.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <online_dag.h>
+
+const long long GRID_MOD = 1000000007LL;
+
+
+// A W x W grid, where node (i, j) depends on (i-1, j) and (i, j-1),
+// and every node in a row after the first also depends on (0, 0).
+// Its value is the number of monotone paths to it from (0, 0).
+class GridNode final : public OnlineNabbitNode {
+ public:
+  int W;
+  long long value;
+  int runs;
+  std::vector<GridNode>* grid;
+
+  GridNode() : OnlineNabbitNode(0), W(0), value(0), runs(0), grid(NULL) { }
+
+ protected:
+  void Compute() {
+    long long i = this->key / W;
+    long long j = this->key % W;
+    long long v = (this->key == 0) ? 1 : 0;
+    if (i > 0) {
+      assert((*grid)[this->key - W].is_computed());
+      v += (*grid)[this->key - W].value;
+    }
+    if (j > 0) {
+      assert((*grid)[this->key - 1].is_computed());
+      v += (*grid)[this->key - 1].value;
+    }
+    assert((*grid)[0].is_computed() || (this->key == 0));
+    this->value = v % GRID_MOD;
+    this->runs++;
+  }
+};
+
+
+// Adds the grid one row at a time.  Within a row, nodes are added
+// from right to left, so each node gets an edge from a left neighbor
+// that is not closed yet.
+void online_dag_test(int W) {
+  std::vector<GridNode> grid((long long)W * W);
+  for (long long k = 0; k < (long long)W * W; k++) {
+    grid[k].key = k;
+    grid[k].W = W;
+    grid[k].grid = &grid;
+  }
+
+  OnlineDAG<GridNode> dag;
+  nabbit::execute([&]() {
+      dag.run([&]() {
+          for (int i = 0; i < W; i++) {
+            for (int j = W - 1; j >= 0; j--) {
+              dag.add_node(&grid[(long long)i * W + j]);
+            }
+            for (int j = W - 1; j >= 0; j--) {
+              long long k = (long long)i * W + j;
+              if (i > 0) {
+                dag.add_edge(&grid[k - W], &grid[k]);
+                dag.add_edge(&grid[0], &grid[k]);
+              }
+              if (j > 0) {
+                dag.add_edge(&grid[k - 1], &grid[k]);
+              }
+              dag.close_node(&grid[k]);
+            }
+          }
+        });
+    });
+  assert(dag.num_nodes() == (long long)W * W);
+
+  std::vector<long long> expected((long long)W * W, 0);
+  for (long long k = 0; k < (long long)W * W; k++) {
+    long long i = k / W;
+    long long j = k % W;
+    expected[k] = (k == 0) ? 1 : 0;
+    if (i > 0) { expected[k] += expected[k - W]; }
+    if (j > 0) { expected[k] += expected[k - 1]; }
+    expected[k] %= GRID_MOD;
+    assert(grid[k].runs == 1);
+    assert(grid[k].value == expected[k]);
+  }
+  std::cout << "Online DAG test passed, W = " << W
+            << ", edges = " << dag.num_edges()
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 200;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  for (int rep = 0; rep < 3; rep++) {
+    online_dag_test(W);
+  }
+  online_dag_test(1);
+  return 0;
+}
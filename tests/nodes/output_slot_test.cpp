@@ -0,0 +1,125 @@
+/*
+ * output_slot_test.cpp
+ *
+ * Runs a grid of static Nabbit nodes that pass their outputs to their
+ * successors through StaticOutputSlots, and checks that the buffers
+ * in use track the frontier of the grid instead of the whole grid.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <output_slot.h>
+#include <static_dag.h>
+
+const long long SLOT_MOD = 1000000007LL;
+
+typedef std::vector<long long> Row;
+
+
+// Node (i, j) of a W x W grid depends on (i-1, j) and (i, j-1).  Its
+// output is a row of L values, each the sum of the same entry of its
+// predecessors' outputs, plus its index.
+class SlotNode final : public StaticNabbitNode {
+ public:
+  int L;
+  StaticOutputSlot<Row> slot;
+
+  SlotNode(long long k, int L_) : StaticNabbitNode(k), L(L_) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    Row* out = slot.allocate();
+    out->assign(L, 0);
+    for (int p = 0; p < this->num_predecessors(); p++) {
+      Row* in = ((SlotNode*)this->predecessor(p))->slot.get();
+      assert((int)in->size() == L);
+      for (int k = 0; k < L; k++) {
+        (*out)[k] += (*in)[k];
+      }
+    }
+    for (int k = 0; k < L; k++) {
+      (*out)[k] = ((*out)[k] + k + 1) % SLOT_MOD;
+    }
+  }
+};
+
+
+void output_slot_test(int W, int L) {
+  OutputPool<Row> pool;
+  StaticDAG<StaticNabbitNode> dag;
+  for (long long k = 0; k < (long long)W * W; k++) {
+    SlotNode* n = new SlotNode(k, L);
+    n->init_node(2);
+    if (k / W > 0) {
+      n->add_dep(dag.get_node(k - W));
+    }
+    if (k % W > 0) {
+      n->add_dep(dag.get_node(k - 1));
+    }
+    dag.add_node(n);
+  }
+  dag.freeze();
+  for (long long k = 0; k < (long long)W * W; k++) {
+    ((SlotNode*)dag.get_node(k))->slot.attach(dag.get_node(k), &pool);
+  }
+
+  // The same grid, serially, with every row kept.
+  std::vector<Row> expected((long long)W * W, Row(L, 0));
+  for (long long k = 0; k < (long long)W * W; k++) {
+    for (int i = 0; i < L; i++) {
+      long long v = i + 1;
+      if (k / W > 0) { v += expected[k - W][i]; }
+      if (k % W > 0) { v += expected[k - 1][i]; }
+      expected[k][i] = v % SLOT_MOD;
+    }
+  }
+
+  long long sink = (long long)W * W - 1;
+  for (int rep = 0; rep < 3; rep++) {
+    nabbit::execute([&]() { dag.execute_all(); });
+
+    // Only the sink still holds a buffer.
+    for (long long k = 0; k < sink; k++) {
+      assert(!((SlotNode*)dag.get_node(k))->slot.has_buffer());
+    }
+    SlotNode* s = (SlotNode*)dag.get_node(sink);
+    assert(*s->slot.get() == expected[sink]);
+    assert(pool.get_live() == 1);
+    dag.reset();
+  }
+
+  // A computed node's buffer is live until its successors finish.
+  // The finished nodes form a staircase with at most 2W - 1 nodes on
+  // its edge, and each running node holds one more.
+  assert(pool.get_peak() <= 2 * W + NABBIT_WKR_COUNT);
+  assert(pool.get_allocated() == pool.get_peak());
+
+  // Dropping the sink's buffer returns it to the pool.
+  ((SlotNode*)dag.get_node(sink))->slot.release();
+  assert(pool.get_live() == 0);
+
+  for (long long k = 0; k < (long long)W * W; k++) {
+    delete (SlotNode*)dag.get_node(k);
+  }
+  std::cout << "Output slot test passed, W = " << W
+            << ", peak buffers = " << pool.get_peak()
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 64;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  output_slot_test(W, 16);
+  output_slot_test(8, 1000);
+  return 0;
+}
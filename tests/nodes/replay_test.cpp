@@ -0,0 +1,187 @@
+/*
+ * replay_test.cpp
+ *
+ * Records the schedule of a static Nabbit DAG run with
+ * StaticDAG::execute_and_record(), and checks that execute_replay()
+ * computes every node after its predecessors, on every run, and stops
+ * when a node throws.  Also records from a thread that is not a
+ * worker.
+ *
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+
+const long long REPLAY_MOD = 1000000007LL;
+
+
+// Each node adds up the values of its predecessors, plus 1, after
+// checking that they have all been computed.  Node throw_key throws
+// instead, if it is set.
+class SumNode final : public StaticNabbitNode {
+ public:
+  long long value;
+  long long* throw_key;
+
+  SumNode(long long k, long long* throw_key_)
+    : StaticNabbitNode(k), value(-1), throw_key(throw_key_) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    if (this->key == *throw_key) {
+      throw std::runtime_error("replay");
+    }
+    long long v = 1;
+    for (int i = 0; i < this->num_predecessors(); i++) {
+      SumNode* pred = (SumNode*)this->predecessor(i);
+      assert(pred->value >= 0);
+      v += pred->value;
+    }
+    value = v % REPLAY_MOD;
+  }
+};
+
+
+// A random DAG of V nodes, each with up to D edges from the previous
+// span nodes, so that it has both width and depth.
+void build_dag(StaticDAG<StaticNabbitNode>* dag, long long V, int D,
+               long long span, long long* throw_key,
+               std::vector<long long>* expected) {
+  expected->assign(V, 0);
+  for (long long k = 0; k < V; k++) {
+    SumNode* n = new SumNode(k, throw_key);
+    n->init_node(D);
+    long long v = 1;
+    int d = (k > 0) ? rand() % (D + 1) : 0;
+    for (int e = 0; e < d; e++) {
+      long long p = k - 1 - rand() % std::min(k, span);
+      n->add_dep(dag->get_node(p));
+      v += (*expected)[p];
+    }
+    (*expected)[k] = v % REPLAY_MOD;
+    dag->add_node(n);
+  }
+  dag->freeze();
+}
+
+void clear_values(StaticDAG<StaticNabbitNode>* dag) {
+  for (long long k = 0; k < dag->num_nodes(); k++) {
+    ((SumNode*)dag->get_node(k))->value = -1;
+  }
+}
+
+void check_values(StaticDAG<StaticNabbitNode>* dag,
+                  const std::vector<long long>& expected) {
+  for (long long k = 0; k < dag->num_nodes(); k++) {
+    assert(((SumNode*)dag->get_node(k))->value == expected[k]);
+  }
+}
+
+
+void replay_test(long long V, int D, long long span, int reps) {
+  srand(V + D);
+  long long throw_key = -1;
+  std::vector<long long> expected;
+  StaticDAG<StaticNabbitNode> dag;
+  build_dag(&dag, V, D, span, &throw_key, &expected);
+  assert(!dag.has_schedule());
+
+  nabbit::execute([&]() { dag.execute_and_record(); });
+  assert(dag.has_schedule());
+  check_values(&dag, expected);
+  dag.reset();
+
+  long long steals = 0;
+  for (int rep = 0; rep < reps; rep++) {
+    clear_values(&dag);
+    nabbit::execute([&]() { dag.execute_replay(); });
+    check_values(&dag, expected);
+    steals += dag.num_replay_steals();
+    dag.reset();
+  }
+  // With one worker, there is nobody to steal from.
+  if (NABBIT_WKR_COUNT == 1) {
+    assert(steals == 0);
+  }
+
+  // A node that throws stops the replay, and the exception reaches
+  // the caller.
+  throw_key = V / 2;
+  bool caught = false;
+  try {
+    nabbit::execute([&]() { dag.execute_replay(); });
+  }
+  catch (std::runtime_error& e) {
+    caught = true;
+  }
+  assert(caught);
+  throw_key = -1;
+
+  // The schedule survives, and the DAG runs again after a reset.
+  dag.reset();
+  clear_values(&dag);
+  nabbit::execute([&]() { dag.execute_replay(); });
+  check_values(&dag, expected);
+
+  for (long long k = 0; k < V; k++) {
+    delete (SumNode*)dag.get_node(k);
+  }
+  std::cout << "Replay test passed, V = " << V << ", D = " << D
+            << ", span = " << span
+            << ", steals = " << steals
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+// Records the DAG from a thread that is not a worker, so nodes may run
+// without a worker id, and checks that the replay still computes them.
+void foreign_record_test(long long V) {
+  srand(V);
+  long long throw_key = -1;
+  std::vector<long long> expected;
+  StaticDAG<StaticNabbitNode> dag;
+  build_dag(&dag, V, 3, 64, &throw_key, &expected);
+
+  std::thread recorder([&]() { dag.execute_and_record(); });
+  recorder.join();
+  assert(dag.has_schedule());
+  check_values(&dag, expected);
+  dag.reset();
+
+  for (int rep = 0; rep < 3; rep++) {
+    clear_values(&dag);
+    nabbit::execute([&]() { dag.execute_replay(); });
+    check_values(&dag, expected);
+    dag.reset();
+  }
+
+  for (long long k = 0; k < V; k++) {
+    delete (SumNode*)dag.get_node(k);
+  }
+  std::cout << "Replay foreign record test passed, V = " << V
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  long long V = 20000;
+  if (argc >= 2) {
+    V = atol(argv[1]);
+  }
+  replay_test(V, 3, 64, 5);
+  replay_test(V, 1, 1, 3);
+  replay_test(V, 8, V, 3);
+  replay_test(1, 1, 1, 2);
+  foreign_record_test(V);
+  return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * sink_compute_test.cpp
+ *
+ * Runs StaticDAG::sink_compute() and StaticDAG::recompute() on a
+ * grid, and checks that they compute exactly the ancestors of the
+ * requested sinks, or the descendants of the dirty nodes.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <nabbit_sysdep.h>
+
+#include <static_dag.h>
+#include <static_dag_builder.h>
+
+const long long GRID_MOD = 1000000007LL;
+
+
+// A W x W grid, where node (i, j) depends on (i-1, j) and (i, j-1).
+// Its value is its input plus the values of its predecessors.  With
+// input 1 at (0, 0) and 0 elsewhere, that is the number of monotone
+// paths to it from (0, 0).
+class GridNode final : public StaticNabbitNode {
+ public:
+  int W;
+  long long value;
+  std::vector<int>* runs;
+  std::vector<long long>* input;
+
+  GridNode()
+    : StaticNabbitNode(0), W(0), value(0), runs(NULL), input(NULL) { }
+
+ protected:
+  void InitNode() { }
+  void Compute() {
+    long long v = (*input)[this->key];
+    for (int j = 0; j < this->num_predecessors(); j++) {
+      GridNode* pred = (GridNode*)this->predecessor(j);
+      assert((*runs)[pred->key] > 0);
+      v += pred->value;
+    }
+    this->value = v % GRID_MOD;
+    (*runs)[this->key]++;
+  }
+};
+
+
+// Plus a hub node, key W*W, which depends on every node in the
+// bottom row and the right column.
+void sink_compute_test(int W) {
+  long long V = (long long)W * W + 1;
+  long long hub = V - 1;
+  std::vector<int> runs(V, 0);
+  std::vector<long long> input(V, 0);
+  input[0] = 1;
+  std::vector<GridNode> nodes(V);
+  for (long long k = 0; k < V; k++) {
+    nodes[k].key = k;
+    nodes[k].W = W;
+    nodes[k].runs = &runs;
+    nodes[k].input = &input;
+  }
+
+  std::vector<long long> src;
+  std::vector<long long> dst;
+  for (long long k = 0; k < hub; k++) {
+    long long i = k / W;
+    long long j = k % W;
+    if (i > 0) { src.push_back(k - W); dst.push_back(k); }
+    if (j > 0) { src.push_back(k - 1); dst.push_back(k); }
+    if ((i == W - 1) || (j == W - 1)) { src.push_back(k); dst.push_back(hub); }
+  }
+  StaticDAG<StaticNabbitNode> dag;
+  StaticDAGBuilder<StaticNabbitNode> builder(V);
+  builder.add_edges(src.data(), dst.data(), (long long)src.size());
+  builder.build_from_array(&dag, nodes.data());
+
+  // A full run, for the expected values.
+  nabbit::execute([&]() { nodes[0].source_compute(); });
+  std::vector<long long> expected(V);
+  for (long long k = 0; k < V; k++) {
+    assert(runs[k] == 1);
+    expected[k] = nodes[k].value;
+  }
+  dag.reset();
+
+  // One interior sink, then two overlapping sinks, then the hub.
+  long long a = (W / 2) * W + (W / 3);
+  long long b = (W / 3) * W + (W / 2);
+  std::vector<std::vector<long long> > requests;
+  requests.push_back(std::vector<long long>(1, a));
+  requests.push_back(std::vector<long long>());
+  requests.back().push_back(a);
+  requests.back().push_back(b);
+  requests.push_back(std::vector<long long>(1, hub));
+
+  for (size_t r = 0; r < requests.size(); r++) {
+    std::vector<StaticNabbitNode*> sinks;
+    for (size_t s = 0; s < requests[r].size(); s++) {
+      sinks.push_back(&nodes[requests[r][s]]);
+    }
+    for (long long k = 0; k < V; k++) {
+      runs[k] = 0;
+      nodes[k].value = -1;
+    }
+    nabbit::execute([&]() {
+        dag.sink_compute(sinks.data(), (int)sinks.size());
+      });
+
+    // Node (i, j) is an ancestor of (si, sj) if i <= si and j <= sj.
+    for (long long k = 0; k < V; k++) {
+      bool needed = false;
+      for (size_t s = 0; s < requests[r].size(); s++) {
+        long long t = requests[r][s];
+        if (t == hub) {
+          needed = true;
+        }
+        else if ((k != hub) &&
+                 (k / W <= t / W) && (k % W <= t % W)) {
+          needed = true;
+        }
+      }
+      assert(runs[k] == (needed ? 1 : 0));
+      if (needed) {
+        assert(nodes[k].value == expected[k]);
+      }
+    }
+  }
+
+  // The DAG is left ready for a full run.
+  nabbit::execute([&]() { nodes[0].source_compute(); });
+  for (long long k = 0; k < V; k++) {
+    assert(nodes[k].value == expected[k]);
+  }
+  dag.reset();
+
+  // Change the inputs of two nodes, and recompute from them.  Only
+  // their descendants should run.
+  long long d1 = (W / 2) * W + (W / 3);
+  long long d2 = (W / 3) * W + (W / 2);
+  input[d1] += 5;
+  input[d2] += 11;
+  for (long long k = 0; k < V; k++) {
+    runs[k] = 1;
+  }
+  StaticNabbitNode* dirty[] = { &nodes[d1], &nodes[d2] };
+  nabbit::execute([&]() { dag.recompute(dirty, 2); });
+
+  for (long long k = 0; k < V; k++) {
+    bool affected = (k == hub);
+    long long dirty_keys[] = { d1, d2 };
+    for (int s = 0; s < 2; s++) {
+      long long t = dirty_keys[s];
+      if ((k != hub) && (k / W >= t / W) && (k % W >= t % W)) {
+        affected = true;
+      }
+    }
+    assert(runs[k] == (affected ? 2 : 1));
+  }
+
+  // Compare against a full run with the new inputs.
+  std::vector<long long> incremental(V);
+  for (long long k = 0; k < V; k++) {
+    incremental[k] = nodes[k].value;
+    runs[k] = 0;
+  }
+  nabbit::execute([&]() { nodes[0].source_compute(); });
+  for (long long k = 0; k < V; k++) {
+    assert(nodes[k].value == incremental[k]);
+  }
+  std::cout << "Sink compute test passed, W = " << W
+            << ", P = " << NABBIT_WKR_COUNT << "\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  int W = 300;
+  if (argc >= 2) {
+    W = atoi(argv[1]);
+  }
+  sink_compute_test(W);
+  sink_compute_test(3);
+  return 0;
+}